@@ -2,24 +2,36 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <bit>
 #include <concepts>
 #include <cstring>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <ranges>
 #include <shared_mutex>
 #include <span>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "serialization.hpp"
+#include "contention.hpp"
+#include "embedded_dump.hpp"
 #include "helpers.hpp"
+#include "latency.hpp"
+#include "persistence.hpp"
+#include "prefetch.hpp"
+#include "probes.hpp"
+#include "simd_hash.hpp"
 
 namespace Caching {
 
@@ -28,45 +40,47 @@ namespace Caching {
  *
  * Implements convenient way to create key for Cache and ConcurrentCache classes
  * Internally uses std::tuple adding serialization capability
+ * Components are trivially copyable values, classes providing serialize or aggregates, the latter
+ * are packed field by field and compared with their operator== or field-wise when they have none
  */
 template <typename... T>
 class Dependances
 {
 public:
     using Values = std::tuple<T...>;
-    static constexpr size_t BinSize = []{  // size of byte array representing all values in internal tuple
-        Values v;
-        size_t size = 0;
-        std::apply([&](auto&&... args) {((size += sizeof(args)), ...);}, v);
-        return size;
-    }();
+    // size of byte array representing all values in internal tuple
+    static constexpr size_t BinSize = (bin_size_v<T> + ... + 0);
 
     constexpr Dependances(T... args) : vals{std::make_tuple(args...)} {}
     constexpr Dependances() = default;
 
     constexpr bool operator==(const Dependances& deps) const
     {
-        return this->vals == deps.vals;
+        return [&]<size_t... I>(std::index_sequence<I...>) {
+            return (Caching::equal(std::get<I>(vals), std::get<I>(deps.vals)) && ...);
+        }(std::index_sequence_for<T...>{});
     }
 
-    const auto& get_vals() const { return vals; }
+    constexpr const auto& get_vals() const { return vals; }
 
-    std::array<std::byte, BinSize> serialize() const
+    constexpr std::array<std::byte, BinSize> serialize() const
     {
-        std::array<std::byte, BinSize> bytes;
-        auto to_byte_arr = [&, offset = 0]<typename Type>(Type&& val) mutable {
-            new (bytes.data() + offset) std::remove_cvref_t<Type>(std::forward<Type>(val));
-            offset += sizeof(Type);
+        std::array<std::byte, BinSize> bytes{};
+        size_t offset = 0;
+        auto to_byte_arr = [&](const auto& val) {
+            Caching::serialize_to(val, bytes.data() + offset);
+            offset += bin_size_v<std::remove_cvref_t<decltype(val)>>;
         };
-        std::apply([&](auto&&... args) {((to_byte_arr(std::forward<decltype(args)>(args))), ...);}, vals);
+        std::apply([&](const auto&... args) {((to_byte_arr(args)), ...);}, vals);
         return bytes;
     }
 
     static Dependances deserialize(std::span<std::byte, BinSize> bytes) {
         Dependances deps;
-        auto from_byte_arr = [&, offset = 0](auto& val) mutable {
-            std::memcpy(&val, bytes.data() + offset, sizeof(val));
-            offset += sizeof(val);
+        auto from_byte_arr = [&, offset = size_t{0}](auto& val) mutable {
+            using V = std::remove_cvref_t<decltype(val)>;
+            val = Caching::deserialize<V>(std::span<std::byte, bin_size_v<V>>{bytes.data() + offset, bin_size_v<V>});
+            offset += bin_size_v<V>;
         };
         std::apply([&](auto&&... args) {((from_byte_arr(args)), ...);}, deps.vals);
         return deps;
@@ -85,44 +99,57 @@ private:
  * @tparam Key type of a key for internal std::unordered_map
  * @tparam Value type of cached values
  * @tparam Tag file tag string for identificaion
+ * @tparam Allocator allocator for table nodes, e.g. HugePageAllocator
+ *
+ * When an embedded_dump specialization for the Tag is visible, its read-only table answers loads
+ * without any file I/O and the map holds stores layered on top of it, persisted to an overlay
+ * dump file only if the table enables overlay
  */
-template <typename Key, typename Value, StringLiteral Tag = "">
+template <typename Key, typename Value, StringLiteral Tag = "",
+          typename Allocator = std::allocator<std::pair<const Key, Value>>>
 class Cache
 {
 public:
-    Cache()
+    using Storage = std::unordered_map<Key, Value, KeyHash<Key>, KeyEqual<Key>, Allocator>;
+
+    /// Whether contents are compiled into the binary
+    static constexpr bool embedded = embedded_dump<Tag>.present();
+
+    Cache() : Cache(LoadBudget{}) {}
+
+    /// @param budget limits of restoring the dump file, entries over them are dropped, hottest
+    /// kept when the dump carries access counters
+    explicit Cache(const LoadBudget& budget)
     {
-        load_from_file();
+        if constexpr (embedded)
+        {
+            static_assert(embedded_dump<Tag>.fingerprint == type_fingerprint<Key, Value>,
+                          "embedded dump was generated for other Key and Value types");
+        }
+        if constexpr (persistent)
+        {
+            load_from_file(budget);
+        }
+        if constexpr (embedded)
+        {
+            shadowed = std::ranges::count_if(storage, [](const auto& entry) { return embedded_load(entry.first).has_value(); });
+        }
     }
 
     ~Cache()
     {
-        dump_to_file();
+        if constexpr (persistent)
+        {
+            dump_to_file();
+        }
     }
 
     /// @brief Getter for file name for cache dump
     /// @return name of an associated file
     static const std::string& get_cache_file_name()
     {
-        static std::string cache_file_name = []{
-            using namespace std::string_literals;
-            // Calculating of an associated file name based on types of key and value
-            std::string res = "_cache";
-            std::apply(
-                [&](auto&&... args) {
-                    ((res += ("_"s + typeid(decltype(args)).name())), ...);
-                },
-                Key{}.get_vals());
-            res += "__";
-            res += typeid(Value).name();
-            if constexpr (std::string_view{Tag.value} != "")
-            {
-                res += "_" + std::string{Tag.value};
-            }
-            res += ".bin";
-            return res;
-        }();
-        return cache_file_name;
+        static const std::string file_name = Caching::cache_file_name<Key, Value, Tag>(embedded ? "overlay" : "");
+        return file_name;
     }
 
     /// @brief Obtaines value by provided key if present
@@ -130,10 +157,69 @@ public:
     /// @return std::optional for value
     [[nodiscard]] std::optional<Value> load(const Key& key) const
     {
-        if (storage.find(key) != storage.end()) {
-            return storage.at(key);
+        LatencyTimer<Tag> timer{Operation::Load};
+        return load_entry(key);
+    }
+
+    /// @brief Obtaines value by provided key with precomputed hash if present
+    /// @param key key for value with its hash
+    /// @return std::optional for value
+    template <std::same_as<HashedKey<Key>> K>
+    [[nodiscard]] std::optional<Value> load(const K& key) const
+    {
+        LatencyTimer<Tag> timer{Operation::Load};
+        return load_entry(key);
+    }
+
+    /// @brief Starts fetching table memory for the key so a following load hits warm cache lines
+    /// @param key key expected to be loaded soon
+    /// @return key with its hash to pass to the following load
+    HashedKey<Key> prefetch(const Key& key) const
+    {
+        HashedKey<Key> hashed{key};
+        prefetch(hashed);
+        return hashed;
+    }
+
+    /// @brief Starts fetching table memory for the key with precomputed hash
+    /// Partial probe rather than a pure hint: reading the bucket array slot to find the first
+    /// node of the bucket is an ordinary load that blocks on a miss, only that node is prefetched
+    /// @param key key expected to be loaded soon with its hash
+    void prefetch(const HashedKey<Key>& key) const
+    {
+        const size_t bucket_count = storage.bucket_count();
+        if (bucket_count == 0)
+        {
+            return;
         }
-        return std::nullopt;
+#if defined(__GLIBCXX__) || defined(_LIBCPP_VERSION)
+        // libstdc++ and libc++ map hashes to buckets by modulo, libc++ masks power of two counts
+        const size_t bucket = key.hash() % bucket_count;
+#else
+        const size_t bucket = storage.bucket(key.get());
+#endif
+        if (auto it = storage.begin(bucket); it != storage.end(bucket))
+        {
+            prefetch_address(std::addressof(*it));
+        }
+    }
+
+    /// @brief Enables speculative prefetching of keys continuing a detected stride of loaded keys
+    /// Detection state is kept per thread and shared by caches of the same type
+    /// @param distance how many strides ahead to prefetch, 0 disables prediction
+    void set_predictive_prefetch(size_t distance)
+    {
+        prefetch_distance.store(distance, std::memory_order_relaxed);
+    }
+
+    /// @brief Obtaines values for a batch of keys, keys are hashed several at once by SIMD kernels
+    /// @param keys keys for values
+    /// @return std::optional for value per key
+    [[nodiscard]] std::vector<std::optional<Value>> load_many(std::span<const Key> keys) const
+    {
+        std::vector<std::optional<Value>> values(keys.size());
+        load_many_impl(keys, values);
+        return values;
     }
 
     /// @brief Saves value to the cache
@@ -143,84 +229,527 @@ public:
     template <typename V>
     void store(const Key& deps, V&& value)
     {
-        storage[deps] = std::forward<V>(value);
+        LatencyTimer<Tag> timer{Operation::Store};
+        store_impl(deps, std::forward<V>(value));
+    }
+
+    /// @brief Saves value to the cache, hash is reused for lookup, a missing key is hashed again on insertion
+    /// @tparam V type for value. Required for perfect forwarding
+    /// @param deps key for storing value with its hash
+    /// @param value value to store at key
+    template <std::same_as<HashedKey<Key>> K, typename V>
+    void store(const K& deps, V&& value)
+    {
+        LatencyTimer<Tag> timer{Operation::Store};
+        store_impl(deps, std::forward<V>(value));
+    }
+
+    /// @brief Obtaines value by provided key computing and storing it if absent
+    /// @param key key for value
+    /// @param compute callable returning value for missing key
+    /// @return cached or computed value
+    template <typename F>
+    Value get_or_compute(const Key& key, F&& compute)
+    {
+        LatencyTimer<Tag> timer{Operation::GetOrCompute};
+        if constexpr (embedded)
+        {
+            if (!storage.contains(key))
+            {
+                if (auto value = embedded_load(key))
+                {
+                    return *std::move(value);
+                }
+            }
+        }
+        return storage.try_emplace(key, lazy_value(compute)).first->second;
+    }
+
+    /// @brief Obtaines value by provided key with precomputed hash computing and storing it if absent
+    /// @param key key for value with its hash
+    /// @param compute callable returning value for missing key
+    /// @return cached or computed value
+    template <std::same_as<HashedKey<Key>> K, typename F>
+    Value get_or_compute(const K& key, F&& compute)
+    {
+        LatencyTimer<Tag> timer{Operation::GetOrCompute};
+        if (auto it = storage.find(key); it != storage.end())
+        {
+            return it->second;
+        }
+        if constexpr (embedded)
+        {
+            if (auto value = embedded_load(key))
+            {
+                return *std::move(value);
+            }
+        }
+        return storage.try_emplace(key.get(), lazy_value(compute)).first->second;
+    }
+
+    /// @brief Number of cached entries
+    [[nodiscard]] size_t size() const
+    {
+        if constexpr (embedded)
+        {
+            return storage.size() + embedded_dump<Tag>.count - shadowed;
+        }
+        return storage.size();
+    }
+
+    /// @brief Moves entries out of sparsely used arena chunks into new nodes allocated densely,
+    /// then returns pages of emptied chunks to the system
+    /// Proceeds bucket by bucket from where the previous call stopped, for allocators such as
+    /// HugePageAllocator telling sparse memory apart. The call completing a pass that moved entries
+    /// also reallocates the bucket array, which otherwise keeps the chunk it was placed in resident
+    /// @param max_entries bound of entries moved by the call
+    /// @return whether the call completed a pass over the table
+    bool compact(size_t max_entries)
+        requires requires(const Allocator& alloc, const void* ptr) {
+            alloc.sparse(ptr);
+            alloc.trim();
+        }
+    {
+        const Allocator alloc = storage.get_allocator();
+        std::vector<Key> keys;
+        for (size_t moved = 0; compact_cursor < storage.bucket_count() && moved < max_entries; compact_cursor++)
+        {
+            keys.clear();
+            for (auto it = storage.begin(compact_cursor); it != storage.end(compact_cursor); ++it)
+            {
+                if (alloc.sparse(std::addressof(*it)))
+                {
+                    keys.push_back(it->first);
+                }
+            }
+            // Size is unchanged after each reinsertion, so the table does not rehash
+            for (const Key& key : keys)
+            {
+                auto node = storage.extract(key);
+                storage.emplace(std::move(node.key()), std::move(node.mapped()));
+            }
+            moved += keys.size();
+            compact_moved += keys.size();
+        }
+        if (compact_cursor < storage.bucket_count())
+        {
+            alloc.trim();
+            return false;
+        }
+        if (compact_moved != 0)
+        {
+            // Rehashing to another bucket count and back keeps the count but allocates a new array
+            const size_t buckets = storage.bucket_count();
+            storage.rehash(buckets + 1);
+            storage.rehash(buckets);
+        }
+        alloc.trim();
+        compact_cursor = 0;
+        compact_moved = 0;
+        return true;
+    }
+
+    /// @brief Read only sized range over cached entries
+    /// @return view of (key, value) pairs, a copy for caches with embedded table
+    [[nodiscard]] auto entries() const
+    {
+        if constexpr (embedded)
+        {
+            std::vector<std::pair<Key, Value>> all{storage.begin(), storage.end()};
+            auto append = [&](const Key& key, const Value& value) { all.emplace_back(key, value); };
+            for_each_embedded(append);
+            return all;
+        }
+        else
+        {
+            return std::views::all(storage);
+        }
+    }
+
+    /// @brief Invokes function for every cached entry
+    /// @param fn callable accepting (const Key&, const Value&)
+    template <typename F>
+    void for_each(F&& fn) const
+    {
+        for (const auto& [key, value] : storage)
+        {
+            std::invoke(fn, key, value);
+        }
+        for_each_embedded(fn);
+    }
+
+    /// @brief Invokes function for every cached entry according to execution policy
+    /// @param policy Caching::execution::seq or Caching::execution::par
+    /// @param fn callable accepting (const Key&, const Value&), invoked concurrently for par
+    template <execution::policy Policy, typename F>
+    void for_each(Policy&& policy, F&& fn) const
+    {
+        if constexpr (std::same_as<std::remove_cvref_t<Policy>, execution::sequenced_policy>)
+        {
+            for_each(fn);
+        }
+        else
+        {
+            for_each_parallel(policy.threads, fn);
+            for_each_embedded(fn);
+        }
     }
 
 protected:
-    std::vector<std::byte> serialize() const
+    /// @brief Converts to value by invoking callable, lets try_emplace compute value only on insertion
+    template <typename F>
+    struct LazyValue
+    {
+        operator Value() const
+        {
+            return std::invoke(compute);
+        }
+
+        F& compute;
+    };
+
+    template <typename F>
+    static LazyValue<F> lazy_value(F& compute)
+    {
+        return LazyValue<F>{compute};
+    }
+
+    /// @brief Feeds stride predictor and prefetches predicted key when prediction is enabled
+    void prefetch_predicted(const Key& key) const
+    {
+        const size_t distance = prefetch_distance.load(std::memory_order_relaxed);
+        if (distance == 0)
+        {
+            return;
+        }
+        thread_local StridePredictor<Key> predictor;
+        if (predictor.observe(key))
+        {
+            prefetch(predictor.predict(distance));
+        }
+    }
+
+    /// @brief Untimed load shared by Cache and ConcurrentCache public methods
+    template <typename K>
+    std::optional<Value> load_entry(const K& key) const
+    {
+        if constexpr (std::same_as<K, Key>)
+        {
+            prefetch_predicted(key);
+        }
+        return load_impl(key);
+    }
+
+    template <typename K>
+    std::optional<Value> load_impl(const K& key) const
+    {
+        // Key is hashed for probes once and only while a tracer is attached to any of them
+        [[maybe_unused]] const size_t key_hash =
+            CACHING_PROBE_ENABLED(load_begin) || CACHING_PROBE_ENABLED(load_hit) || CACHING_PROBE_ENABLED(load_miss)
+                ? KeyHash<Key>{}(key)
+                : 0;
+        CACHING_PROBE(load_begin, Tag.value, key_hash);
+        if (auto it = storage.find(key); it != storage.end())
+        {
+            CACHING_PROBE(load_hit, Tag.value, key_hash, sizeof(Value));
+            return it->second;
+        }
+        if constexpr (embedded)
+        {
+            if (auto value = embedded_load(key))
+            {
+                CACHING_PROBE(load_hit, Tag.value, key_hash, sizeof(Value));
+                return value;
+            }
+        }
+        CACHING_PROBE(load_miss, Tag.value, key_hash);
+        return std::nullopt;
+    }
+
+    /// @brief Untimed store shared by Cache and ConcurrentCache public methods
+    template <typename K, typename V>
+    void store_impl(const K& deps, V&& value)
+    {
+        if constexpr (std::same_as<K, HashedKey<Key>>)
+        {
+            CACHING_PROBE(store, Tag.value, deps.hash(), sizeof(Value));
+            if (auto it = storage.find(deps); it != storage.end())
+            {
+                it->second = std::forward<V>(value);
+                return;
+            }
+            storage.try_emplace(deps.get(), std::forward<V>(value));
+            count_shadowed(deps);
+        }
+        else if constexpr (embedded)
+        {
+            CACHING_PROBE(store, Tag.value, KeyHash<Key>{}(deps), sizeof(Value));
+            if (storage.insert_or_assign(deps, std::forward<V>(value)).second)
+            {
+                count_shadowed(deps);
+            }
+        }
+        else
+        {
+            CACHING_PROBE(store, Tag.value, KeyHash<Key>{}(deps), sizeof(Value));
+            storage[deps] = std::forward<V>(value);
+        }
+    }
+
+    /// @brief Accounts a key newly stored on top of the embedded table
+    template <typename K>
+    void count_shadowed(const K& key)
+    {
+        if constexpr (embedded)
+        {
+            if (embedded_load(key))
+            {
+                shadowed++;
+            }
+        }
+    }
+
+    /// @brief Looks key up in the embedded table
+    template <typename K>
+    static std::optional<Value> embedded_load(const K& key)
     {
-        std::vector<std::byte> binary_data{};
+        constexpr const EmbeddedDump& table = embedded_dump<Tag>;
+        const Key& plain = [&]() -> const Key& {
+            if constexpr (std::same_as<K, HashedKey<Key>>)
+            {
+                return key.get();
+            }
+            else
+            {
+                return key;
+            }
+        }();
+        // Tables hold fields in dump byte order and are ordered by hash_bytes of them
+        auto bytes = Caching::serialize(plain);
+        dump_byte_order(bytes, key_fields<Key>());
+        // Dependances hash is hash_bytes of serialized key, precomputed hashes are reused
+        const uint64_t hash = simd::packed_hash_v<Key> && std::endian::native == std::endian::little
+                                  ? KeyHash<Key>{}(key)
+                                  : hash_bytes(bytes);
+        const unsigned char* record = table.find(bytes, hash);
+        if (record == nullptr)
+        {
+            return std::nullopt;
+        }
+        std::array<std::byte, bin_size_v<Value>> value_bytes;
+        std::memcpy(value_bytes.data(), record + table.key_size, bin_size_v<Value>);
+        dump_byte_order(value_bytes, value_fields<Value>());
+        return Caching::deserialize<Value>(std::span{value_bytes});
+    }
+
+    /// @brief Invokes function for entries of the embedded table not replaced by stores
+    template <typename F>
+    void for_each_embedded(F& fn) const
+    {
+        if constexpr (embedded)
+        {
+            constexpr const EmbeddedDump& table = embedded_dump<Tag>;
+            std::array<std::byte, Key::BinSize> key_bytes;
+            std::array<std::byte, bin_size_v<Value>> value_bytes;
+            for (size_t i = 0; i < table.count; i++)
+            {
+                const unsigned char* record = table.records + i * table.record_size();
+                std::memcpy(key_bytes.data(), record, key_bytes.size());
+                dump_byte_order(key_bytes, key_fields<Key>());
+                const Key key = Caching::deserialize<Key>(std::span{key_bytes});
+                if (!storage.contains(key))
+                {
+                    std::memcpy(value_bytes.data(), record + table.key_size, value_bytes.size());
+                    dump_byte_order(value_bytes, value_fields<Value>());
+                    const Value value = Caching::deserialize<Value>(std::span{value_bytes});
+                    std::invoke(fn, key, value);
+                }
+            }
+        }
+    }
+
+    void load_many_impl(std::span<const Key> keys, std::span<std::optional<Value>> values) const
+    {
+        static constexpr size_t batch = 64;
+        std::array<size_t, batch> hashes;
+        for (size_t first = 0; first < keys.size(); first += batch)
+        {
+            const auto chunk = keys.subspan(first, std::min(batch, keys.size() - first));
+            hash_keys(chunk, std::span{hashes});
+            for (size_t i = 0; i < chunk.size(); i++)
+            {
+                values[first + i] = load_impl(HashedKey<Key>{chunk[i], hashes[i]});
+            }
+        }
+    }
+
+    /// @brief Splits bucket range of the table into chunks and iterates them on separate threads
+    template <typename F>
+    void for_each_parallel(unsigned threads, F& fn) const
+    {
+        static constexpr size_t min_chunk_entries = 1024;
+
+        if (threads == 0)
+        {
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        const size_t chunks = std::min<size_t>(threads, std::max<size_t>(storage.size() / min_chunk_entries, 1));
+        if (chunks == 1)
+        {
+            for (const auto& [key, value] : storage)
+            {
+                std::invoke(fn, key, value);
+            }
+            return;
+        }
 
-        binary_data.reserve(storage.size() * (sizeof(Key) + sizeof(Value)));
+        const size_t bucket_count = storage.bucket_count();
+        const size_t chunk_buckets = (bucket_count + chunks - 1) / chunks;
+        std::vector<std::exception_ptr> errors(chunks);
 
+        auto process_chunk = [&](size_t chunk) {
+            try
+            {
+                const size_t last = std::min(bucket_count, (chunk + 1) * chunk_buckets);
+                for (size_t bucket = chunk * chunk_buckets; bucket < last; bucket++)
+                {
+                    for (auto it = storage.begin(bucket); it != storage.end(bucket); ++it)
+                    {
+                        std::invoke(fn, it->first, it->second);
+                    }
+                }
+            }
+            catch (...)
+            {
+                errors[chunk] = std::current_exception();
+            }
+        };
+
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(chunks - 1);
+            for (size_t chunk = 1; chunk < chunks; chunk++)
+            {
+                workers.emplace_back(process_chunk, chunk);
+            }
+            process_chunk(0);
+        }
+
+        for (const auto& error : errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    std::vector<std::byte> serialize() const
+    {
+        std::vector<std::byte> binary_data(storage.size() * (Key::BinSize + bin_size_v<Value>));
+
+        std::byte* ptr = binary_data.data();
         for (const auto& [key, value] : storage)
         {
-            auto bin_key = Caching::serialize(key);
-            std::ranges::for_each(
-                bin_key, [&](auto byte) { binary_data.push_back(byte); });
-            auto bin_value = Caching::serialize(value);
-            std::ranges::for_each(
-                bin_value, [&](auto byte) { binary_data.push_back(byte); });
+            Caching::serialize_to(key, ptr);
+            Caching::serialize_to(value, ptr + Key::BinSize);
+            ptr += Key::BinSize + bin_size_v<Value>;
         }
         return binary_data;
     }
 
-    std::unordered_map<Key, Value> deserialize(std::span<std::byte> bytes, size_t cached_count) {
-        std::unordered_map<Key, Value> map;
+    Storage deserialize(std::span<std::byte> bytes, size_t cached_count) {
+        Storage map{storage.get_allocator()};
         map.reserve(cached_count);
         std::byte* ptr = bytes.data();
-        for (size_t i = 0; i <= cached_count; i++, ptr += bytes.size() / cached_count)
+        for (size_t i = 0; i < cached_count; i++, ptr += bytes.size() / cached_count)
         {
             auto key = Caching::deserialize<Key>(std::span<std::byte, Key::BinSize>{ptr, Key::BinSize});
-            auto value = Caching::deserialize<Value>(std::span<std::byte, sizeof(Value)>{ptr + Key::BinSize, sizeof(Value)});
+            auto value = Caching::deserialize<Value>(
+                std::span<std::byte, bin_size_v<Value>>{ptr + Key::BinSize, bin_size_v<Value>});
 
             map[key] = value;
         }
         return map;
     }
 
-    /// @brief Restores data from an associated file
-    void load_from_file()
+    /// @brief Restores entries within budget hottest first, deadline checked every 64 entries
+    Storage deserialize_hottest(DumpPayload& payload, size_t entries, std::chrono::steady_clock::duration max_duration)
     {
-        static constexpr size_t key_val_size = Key::BinSize + sizeof(Value);
-
-        std::ifstream file_dump{get_cache_file_name(), std::ios::binary | std::ios::ate};
+        static constexpr size_t key_val_size = Key::BinSize + bin_size_v<Value>;
 
-        if (!file_dump.good())
+        Storage map{storage.get_allocator()};
+        map.reserve(entries);
+        const auto start = std::chrono::steady_clock::now();
+        const auto order = payload.hotness_order();
+        for (size_t i = 0; i < entries; i++)
         {
-            return;
+            if (i % 64 == 63 && std::chrono::steady_clock::now() - start > max_duration)
+            {
+                break;
+            }
+            std::byte* record = payload.bytes.data() + order[i] * key_val_size;
+            map.try_emplace(Caching::deserialize<Key>(std::span<std::byte, Key::BinSize>{record, Key::BinSize}),
+                            Caching::deserialize<Value>(
+                                std::span<std::byte, bin_size_v<Value>>{record + Key::BinSize, bin_size_v<Value>}));
         }
+        return map;
+    }
 
-        std::ifstream::pos_type len = file_dump.tellg();
+    /// @brief Restores data from an associated file within budget
+    void load_from_file(const LoadBudget& budget)
+    {
+        // Node, hash code and bucket pointer per entry
+        static constexpr size_t entry_size = sizeof(typename Storage::value_type) + 3 * sizeof(void*);
 
-        if (len <= 0)
+        auto payload = Caching::read_records<Key, Value>(get_cache_file_name());
+        if (!payload || payload->count == 0)
         {
             return;
         }
 
-        const size_t cached_count = len / key_val_size;
-
-        std::vector<std::byte> data(len);
+        CACHING_PROBE(file_load_begin, Tag.value);
 
-        file_dump.seekg(0, std::ios::beg);
-        file_dump.read(reinterpret_cast<char*>(data.data()), len);
+        const size_t cached_count = budget.entries(payload->count, entry_size);
 
-        file_dump.close();
-
-        storage.reserve(data.size() / key_val_size);
+        if constexpr (requires { storage.get_allocator().prefault(size_t{}); })
+        {
+            storage.get_allocator().prefault(cached_count * entry_size);
+        }
 
-        storage = this->deserialize(std::span{data.data(), data.size()}, cached_count);
+        if (cached_count == payload->count && budget.max_duration == std::chrono::steady_clock::duration::max())
+        {
+            storage = this->deserialize(payload->bytes, cached_count);
+        }
+        else
+        {
+            storage = deserialize_hottest(*payload, cached_count, budget.max_duration);
+        }
+        CACHING_PROBE(file_load_end, Tag.value, storage.size(), payload->bytes.size());
     }
 
     /// @brief Dumps cache content to an associated file
     void dump_to_file()
     {
-        std::fstream file_dump(get_cache_file_name(), std::ios::out | std::ios::binary);
-        const auto data = this->serialize();
-        file_dump.write(reinterpret_cast<const char*>(data.data()), data.size());
+        CACHING_PROBE(dump_begin, Tag.value, storage.size());
+        auto file_dump = Caching::write_records<Key, Value>(get_cache_file_name());
+        auto data = this->serialize();
+        file_dump.write_rows(data, record_fields<Key, Value>());
+        file_dump.finish(storage.size());
+        CACHING_PROBE(dump_end, Tag.value, data.size());
     }
 
-    std::unordered_map<Key, Value> storage;
+    /// Dump file is read and written unless contents are embedded without overlay
+    static constexpr bool persistent = !embedded || embedded_dump<Tag>.overlay;
+
+    Storage storage;
+    std::atomic<size_t> prefetch_distance = 0;
+    /// Number of stored keys also present in the embedded table
+    size_t shadowed = 0;
+    /// Bucket compact continues from
+    size_t compact_cursor = 0;
+    /// Entries moved by compact since the pass started
+    size_t compact_moved = 0;
 };
 
 /**
@@ -231,14 +760,22 @@ protected:
  * @tparam Key type of a key for internal std::unordered_map
  * @tparam Value type of cached values
  * @tparam Tag file tag string for identificaion
+ * @tparam Allocator allocator for table nodes, e.g. HugePageAllocator
  */
-template <typename Key, typename Value, StringLiteral Tag = "">
-class ConcurrentCache : public Cache<Key, Value, Tag>
+template <typename Key, typename Value, StringLiteral Tag = "",
+          typename Allocator = std::allocator<std::pair<const Key, Value>>>
+class ConcurrentCache : public Cache<Key, Value, Tag, Allocator>
 {
+    using Base = Cache<Key, Value, Tag, Allocator>;
+
 public:
-    ConcurrentCache()
+    ConcurrentCache() : ConcurrentCache(LoadBudget{}) {}
+
+    /// @param budget limits of restoring the dump file, see Cache
+    explicit ConcurrentCache(const LoadBudget& budget) : Base{budget}
     {
-        load_impl_ptr = &load_protected_impl;
+        load_impl_ptr = &load_protected_impl<Key>;
+        load_hashed_impl_ptr = &load_protected_impl<HashedKey<Key>>;
     }
 
     /// @brief Obtaines value by provided key if present concurrently
@@ -246,29 +783,79 @@ public:
     /// @return std::optional for value
     [[nodiscard]] std::optional<Value> load(const Key& key) const
     {
+        LatencyTimer<Tag> timer{Operation::Load};
         return load_impl_ptr(*this, key);
     }
 
+    /// @brief Obtaines value by provided key with precomputed hash if present concurrently
+    /// @param key key for value with its hash
+    /// @return std::optional for value
+    template <std::same_as<HashedKey<Key>> K>
+    [[nodiscard]] std::optional<Value> load(const K& key) const
+    {
+        LatencyTimer<Tag> timer{Operation::Load};
+        return load_hashed_impl_ptr(*this, key);
+    }
+
+    /// @brief Obtaines values for a batch of keys concurrently, hashing happens before taking the lock
+    /// @param keys keys for values
+    /// @return std::optional for value per key
+    [[nodiscard]] std::vector<std::optional<Value>> load_many(std::span<const Key> keys) const
+    {
+        std::vector<std::optional<Value>> values(keys.size());
+        std::vector<size_t> hashes(keys.size());
+        hash_keys(keys, std::span{hashes});
+
+        auto lk = lock_shared(LockOperation::Load);
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            values[i] = this->load_impl(HashedKey<Key>{keys[i], hashes[i]});
+        }
+        return values;
+    }
+
+    /// @brief Starts fetching table memory for the key concurrently
+    /// @param key key expected to be loaded soon
+    /// @return key with its hash to pass to the following load
+    HashedKey<Key> prefetch(const Key& key) const
+    {
+        HashedKey<Key> hashed{key};
+        prefetch(hashed);
+        return hashed;
+    }
+
+    /// @brief Starts fetching table memory for the key with precomputed hash concurrently
+    /// Takes shared lock and reads the bucket array slot like Cache::prefetch
+    /// @param key key expected to be loaded soon with its hash
+    void prefetch(const HashedKey<Key>& key) const
+    {
+        auto lk = lock_shared(LockOperation::Load);
+        Base::prefetch(key);
+    }
+
     /// @brief Obtaines value by provided key if present concurrently without lock
     /// @param key key for value
     /// @return std::optional for value
     [[nodiscard]] std::optional<Value> load_unprotected(const Key& key) const
     {
-        return load_unprotected_impl(*this, key);
+        LatencyTimer<Tag> timer{Operation::Load};
+        return load_unprotected_impl<Key>(*this, key);
     }
 
     /// @brief Sets load implementation to optimize for stores availability
     /// @param can_store flag whether stores can occure
     void set_stores_availability(bool can_store) const
     {
-        std::unique_lock lk{mtx};
+        auto lk = lock_exclusive(LockOperation::Configure);
         if (can_store)
         {
-            load_impl_ptr = &load_protected_impl;
+            load_impl_ptr = &load_protected_impl<Key>;
+            load_hashed_impl_ptr = &load_protected_impl<HashedKey<Key>>;
         }
         else
         {
-            load_impl_ptr = &load_unprotected_impl;
+            load_impl_ptr = &load_unprotected_impl<Key>;
+            load_hashed_impl_ptr = &load_unprotected_impl<HashedKey<Key>>;
         }
     }
 
@@ -279,8 +866,42 @@ public:
     template <typename V>
     void store(const Key& deps, V&& value)
     {
-        std::unique_lock lk{mtx};
-        Cache<Key, Value>::store(deps, std::forward<V>(value));
+        LatencyTimer<Tag> timer{Operation::Store};
+        auto lk = lock_exclusive(LockOperation::Store);
+        this->store_impl(deps, std::forward<V>(value));
+    }
+
+    /// @brief Saves value to the cache cuncurrently reusing precomputed hash
+    /// @tparam V type for value. Required for perfect forwarding
+    /// @param deps key for storing value with its hash
+    /// @param value value to store at key
+    template <std::same_as<HashedKey<Key>> K, typename V>
+    void store(const K& deps, V&& value)
+    {
+        LatencyTimer<Tag> timer{Operation::Store};
+        auto lk = lock_exclusive(LockOperation::Store);
+        this->store_impl(deps, std::forward<V>(value));
+    }
+
+    /// @brief Obtaines value by provided key computing and storing it if absent concurrently
+    /// Value is computed without holding the lock, a value stored meanwhile by another thread wins
+    /// @param key key for value
+    /// @param compute callable returning value for missing key
+    /// @return cached or computed value
+    template <typename F>
+    Value get_or_compute(const Key& key, F&& compute)
+    {
+        return get_or_compute_impl(key, compute);
+    }
+
+    /// @brief Obtaines value by provided key with precomputed hash computing and storing it if absent concurrently
+    /// @param key key for value with its hash
+    /// @param compute callable returning value for missing key
+    /// @return cached or computed value
+    template <std::same_as<HashedKey<Key>> K, typename F>
+    Value get_or_compute(const K& key, F&& compute)
+    {
+        return get_or_compute_impl(key, compute);
     }
 
     /// @brief Saves value to the cache cuncurrently without lock
@@ -290,25 +911,147 @@ public:
     template <typename V>
     void store_unprotected(const Key& deps, V&& value)
     {
-        Cache<Key, Value>::store(deps, std::forward<V>(value));
+        LatencyTimer<Tag> timer{Operation::Store};
+        this->store_impl(deps, std::forward<V>(value));
+    }
+
+    /// @brief Number of cached entries
+    [[nodiscard]] size_t size() const
+    {
+        auto lk = lock_shared(LockOperation::Load);
+        return Base::size();
+    }
+
+    /// @brief Compacts a bounded number of entries under exclusive lock, see Cache::compact
+    /// Readers proceed between calls, so a long compaction is spread into short pauses
+    /// @param max_entries bound of entries moved by the call
+    /// @return whether the call completed a pass over the table
+    bool compact(size_t max_entries)
+        requires requires(const Allocator& alloc, const void* ptr) {
+            alloc.sparse(ptr);
+            alloc.trim();
+        }
+    {
+        auto lk = lock_exclusive(LockOperation::Compact);
+        return Base::compact(max_entries);
+    }
+
+    /// @brief Consistent snapshot of cached entries
+    /// @return vector of (key, value) pairs copied under shared lock
+    [[nodiscard]] std::vector<std::pair<Key, Value>> entries() const
+    {
+        auto lk = lock_shared(LockOperation::Iterate);
+        const auto view = Base::entries();
+        return {view.begin(), view.end()};
+    }
+
+    /// @brief Invokes function for every cached entry under shared lock
+    /// @param fn callable accepting (const Key&, const Value&)
+    template <typename F>
+    void for_each(F&& fn) const
+    {
+        auto lk = lock_shared(LockOperation::Iterate);
+        Base::for_each(std::forward<F>(fn));
+    }
+
+    /// @brief Invokes function for every cached entry according to execution policy under shared lock
+    /// @param policy Caching::execution::seq or Caching::execution::par
+    /// @param fn callable accepting (const Key&, const Value&), invoked concurrently for par
+    template <execution::policy Policy, typename F>
+    void for_each(Policy&& policy, F&& fn) const
+    {
+        auto lk = lock_shared(LockOperation::Iterate);
+        Base::for_each(std::forward<Policy>(policy), std::forward<F>(fn));
+    }
+
+    /// @brief Enables contention profiling of the cache lock
+    /// @param on whether to profile, counters collected so far are kept
+    /// @param thresholds hold and wait limits for flagging contention events
+    void set_contention_profiling(bool on, ContentionThresholds thresholds = {}) const
+    {
+        profiler.enable(on, thresholds);
+    }
+
+    /// @brief Contention counters and flagged events of the cache lock
+    [[nodiscard]] ContentionReport contention_report() const
+    {
+        return profiler.report();
+    }
+
+    /// @brief Clears contention counters and events
+    void reset_contention() const
+    {
+        profiler.reset();
     }
 
 private:
-    [[nodiscard]] static std::optional<Value> load_protected_impl(const ConcurrentCache& self, const Key& key)
+    /// @brief Acquires exclusive lock reporting wait to tracepoints, latency histograms and contention profiler
+    LockProfiler::ExclusiveLock lock_exclusive(LockOperation op) const
+    {
+        LatencyTimer<Tag> timer{Operation::LockWait};
+        CACHING_PROBE(lock_wait_begin, Tag.value, 1);
+        auto lk = profiler.lock_exclusive(mtx, op);
+        CACHING_PROBE(lock_wait_end, Tag.value, 1);
+        return lk;
+    }
+
+    /// @brief Acquires shared lock reporting wait to tracepoints, latency histograms and contention profiler
+    std::shared_lock<std::shared_mutex> lock_shared(LockOperation op) const
+    {
+        LatencyTimer<Tag> timer{Operation::LockWait};
+        CACHING_PROBE(lock_wait_begin, Tag.value, 0);
+        auto lk = profiler.lock_shared(mtx, op);
+        CACHING_PROBE(lock_wait_end, Tag.value, 0);
+        return lk;
+    }
+
+    template <typename K, typename F>
+    Value get_or_compute_impl(const K& key, F& compute)
+    {
+        LatencyTimer<Tag> timer{Operation::GetOrCompute};
+        std::optional<Value> cached;
+        if constexpr (std::same_as<K, Key>)
+        {
+            cached = load_impl_ptr(*this, key);
+        }
+        else
+        {
+            cached = load_hashed_impl_ptr(*this, key);
+        }
+        if (cached)
+        {
+            return *std::move(cached);
+        }
+        Value value = std::invoke(compute);
+        auto lk = lock_exclusive(LockOperation::GetOrCompute);
+        if (auto it = this->storage.find(key); it != this->storage.end())
+        {
+            return it->second;
+        }
+        this->store_impl(key, value);
+        return value;
+    }
+
+    template <typename K>
+    [[nodiscard]] static std::optional<Value> load_protected_impl(const ConcurrentCache& self, const K& key)
     {
-        std::shared_lock lk{self.mtx};
-        return static_cast<const Cache<Key, Value>&>(self).load(key);
+        auto lk = self.lock_shared(LockOperation::Load);
+        return self.load_entry(key);
     }
 
-    [[nodiscard]] static std::optional<Value> load_unprotected_impl(const ConcurrentCache& self, const Key& key)
+    template <typename K>
+    [[nodiscard]] static std::optional<Value> load_unprotected_impl(const ConcurrentCache& self, const K& key)
     {
-        return static_cast<const Cache<Key, Value>&>(self).load(key);
+        return self.load_entry(key);
     }
 
-    using load_impl_ptr_t = std::optional<Value>(*)(const ConcurrentCache& self, const Key&);
+    template <typename K>
+    using load_impl_ptr_t = std::optional<Value>(*)(const ConcurrentCache& self, const K&);
 
-    mutable load_impl_ptr_t load_impl_ptr;
+    mutable load_impl_ptr_t<Key> load_impl_ptr;
+    mutable load_impl_ptr_t<HashedKey<Key>> load_hashed_impl_ptr;
     mutable std::shared_mutex mtx;
+    mutable LockProfiler profiler;
 };
 
 }  // namespace Caching
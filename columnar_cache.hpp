@@ -0,0 +1,356 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "serialization.hpp"
+#include "cache.hpp"
+#include "helpers.hpp"
+#include "persistence.hpp"
+#include "probes.hpp"
+
+namespace Caching {
+
+template <typename Key, typename Value, StringLiteral Tag = "">
+class ColumnarCache;
+
+/**
+ * ColumnarCache class
+ *
+ * Implements caching with struct-of-arrays storage for scans over cached entries
+ * Every Dependances component, values and key hashes are separate dense columns indexed by row,
+ * an open addressing index of row numbers serves lookups. Scans, filters and invalidations
+ * over one component read only that column. Erasing moves the last row into the hole so
+ * columns stay dense
+ * Uses the same dump file format as Cache with identical types and Tag
+ *
+ * @tparam T types of key components
+ * @tparam Value type of cached values
+ * @tparam Tag file tag string for identificaion
+ */
+template <typename... T, typename Value, StringLiteral Tag>
+class ColumnarCache<Dependances<T...>, Value, Tag>
+{
+public:
+    using Key = Dependances<T...>;
+
+    ColumnarCache()
+    {
+        load_from_file();
+    }
+
+    ~ColumnarCache()
+    {
+        dump_to_file();
+    }
+
+    /// @brief Getter for file name for cache dump
+    /// @return name of an associated file
+    static const std::string& get_cache_file_name()
+    {
+        static const std::string file_name = Caching::cache_file_name<Key, Value, Tag>();
+        return file_name;
+    }
+
+    /// @brief Obtaines value by provided key if present
+    /// @param key key for value
+    /// @return std::optional for value
+    [[nodiscard]] std::optional<Value> load(const Key& key) const
+    {
+        if (const auto slot = find(key, std::hash<Key>{}(key)))
+        {
+            return values[index[*slot] - 1];
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Saves value to the cache
+    /// @tparam V type for value. Required for perfect forwarding
+    /// @param deps key for storing value
+    /// @param value value to store at key
+    template <typename V>
+    void store(const Key& deps, V&& value)
+    {
+        const size_t hash = std::hash<Key>{}(deps);
+        if (const auto slot = find(deps, hash))
+        {
+            values[index[*slot] - 1] = std::forward<V>(value);
+            return;
+        }
+        if ((hashes.size() + 1) * 2 > index.size())
+        {
+            reindex(std::max<size_t>(16, index.size() * 2));
+        }
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (std::get<I>(columns).push_back(std::get<I>(deps.get_vals())), ...);
+        }(std::index_sequence_for<T...>{});
+        values.push_back(std::forward<V>(value));
+        hashes.push_back(hash);
+        insert_row(hashes.size() - 1);
+    }
+
+    /// @brief Removes entry
+    /// @param key key of entry
+    /// @return whether entry was present
+    bool erase(const Key& key)
+    {
+        const auto slot = find(key, std::hash<Key>{}(key));
+        if (!slot)
+        {
+            return false;
+        }
+        const size_t row = index[*slot] - 1;
+        remove_slot(*slot);
+        const size_t last = hashes.size() - 1;
+        if (row != last)
+        {
+            index[slot_of(last)] = static_cast<uint32_t>(row + 1);
+            move_row(last, row);
+        }
+        pop_row();
+        return true;
+    }
+
+    /// @brief Number of cached entries
+    [[nodiscard]] size_t size() const
+    {
+        return hashes.size();
+    }
+
+    /// @brief Dense column of a key component, row order matches other columns
+    template <size_t I>
+    [[nodiscard]] std::span<const std::tuple_element_t<I, std::tuple<T...>>> column() const
+    {
+        return std::get<I>(columns);
+    }
+
+    /// @brief Dense column of values, row order matches key columns
+    [[nodiscard]] std::span<const Value> value_column() const
+    {
+        return values;
+    }
+
+    /// @brief Counts entries whose key component satisfies predicate reading only its column
+    /// @tparam I index of key component
+    /// @param pred predicate accepting the component
+    template <size_t I, typename P>
+    [[nodiscard]] size_t count_if(P pred) const
+    {
+        size_t count = 0;
+        for (const auto& val : std::get<I>(columns))
+        {
+            count += static_cast<bool>(pred(val));
+        }
+        return count;
+    }
+
+    /// @brief Removes entries whose key component satisfies predicate
+    /// Predicate is evaluated over the column into a mask, then all columns are compacted in one
+    /// pass and the index is rebuilt from stored hashes
+    /// @tparam I index of key component
+    /// @param pred predicate accepting the component
+    /// @return number of removed entries
+    template <size_t I, typename P>
+    size_t invalidate_if(P pred)
+    {
+        const auto& column = std::get<I>(columns);
+        std::vector<uint8_t> removed(column.size());
+        for (size_t row = 0; row < column.size(); row++)
+        {
+            removed[row] = static_cast<bool>(pred(column[row]));
+        }
+        size_t kept = 0;
+        for (size_t row = 0; row < removed.size(); row++)
+        {
+            if (!removed[row])
+            {
+                if (kept != row)
+                {
+                    move_row(row, kept);
+                }
+                kept++;
+            }
+        }
+        const size_t count = hashes.size() - kept;
+        while (hashes.size() > kept)
+        {
+            pop_row();
+        }
+        reindex(index.size());
+        return count;
+    }
+
+    /// @brief Invokes function for every cached entry in row order
+    /// @param fn callable accepting (const Key&, const Value&)
+    template <typename F>
+    void for_each(F&& fn) const
+    {
+        for (size_t row = 0; row < hashes.size(); row++)
+        {
+            std::invoke(fn, key_at(row), values[row]);
+        }
+    }
+
+protected:
+    Key key_at(size_t row) const
+    {
+        return [&]<size_t... I>(std::index_sequence<I...>) {
+            return Key{std::get<I>(columns)[row]...};
+        }(std::index_sequence_for<T...>{});
+    }
+
+    bool row_equals(size_t row, const Key& key) const
+    {
+        return [&]<size_t... I>(std::index_sequence<I...>) {
+            return (Caching::equal(std::get<I>(columns)[row], std::get<I>(key.get_vals())) && ...);
+        }(std::index_sequence_for<T...>{});
+    }
+
+    /// @brief Slot of index referring to the key
+    std::optional<size_t> find(const Key& key, size_t hash) const
+    {
+        if (index.empty())
+        {
+            return std::nullopt;
+        }
+        const size_t mask = index.size() - 1;
+        for (size_t slot = hash & mask; index[slot] != 0; slot = (slot + 1) & mask)
+        {
+            const size_t row = index[slot] - 1;
+            if (hashes[row] == hash && row_equals(row, key))
+            {
+                return slot;
+            }
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Slot of index referring to a present row
+    size_t slot_of(size_t row) const
+    {
+        const size_t mask = index.size() - 1;
+        size_t slot = hashes[row] & mask;
+        while (index[slot] != row + 1)
+        {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void insert_row(size_t row)
+    {
+        const size_t mask = index.size() - 1;
+        size_t slot = hashes[row] & mask;
+        while (index[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = static_cast<uint32_t>(row + 1);
+    }
+
+    /// @brief Empties index slot shifting following entries back
+    void remove_slot(size_t hole)
+    {
+        const size_t mask = index.size() - 1;
+        for (size_t slot = (hole + 1) & mask; index[slot] != 0; slot = (slot + 1) & mask)
+        {
+            const size_t home = hashes[index[slot] - 1] & mask;
+            if (((slot - home) & mask) >= ((slot - hole) & mask))
+            {
+                index[hole] = index[slot];
+                hole = slot;
+            }
+        }
+        index[hole] = 0;
+    }
+
+    void reindex(size_t capacity)
+    {
+        index.assign(capacity, 0);
+        for (size_t row = 0; row < hashes.size(); row++)
+        {
+            insert_row(row);
+        }
+    }
+
+    void move_row(size_t from, size_t to)
+    {
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            ((std::get<I>(columns)[to] = std::move(std::get<I>(columns)[from])), ...);
+        }(std::index_sequence_for<T...>{});
+        values[to] = std::move(values[from]);
+        hashes[to] = hashes[from];
+    }
+
+    void pop_row()
+    {
+        std::apply([](auto&... column) { (column.pop_back(), ...); }, columns);
+        values.pop_back();
+        hashes.pop_back();
+    }
+
+    /// @brief Restores data from an associated file
+    void load_from_file()
+    {
+        static constexpr size_t key_val_size = Key::BinSize + bin_size_v<Value>;
+
+        auto payload = Caching::read_records<Key, Value>(get_cache_file_name());
+        if (!payload)
+        {
+            return;
+        }
+        CACHING_PROBE(file_load_begin, Tag.value);
+        std::apply([&](auto&... column) { (column.reserve(payload->count), ...); }, columns);
+        values.reserve(payload->count);
+        hashes.reserve(payload->count);
+        reindex(std::bit_ceil(std::max<size_t>(16, payload->count * 2 + 2)));
+        std::byte* record = payload->bytes.data();
+        for (size_t i = 0; i < payload->count; i++, record += key_val_size)
+        {
+            store(Caching::deserialize<Key>(std::span<std::byte, Key::BinSize>{record, Key::BinSize}),
+                  Caching::deserialize<Value>(
+                      std::span<std::byte, bin_size_v<Value>>{record + Key::BinSize, bin_size_v<Value>}));
+        }
+        CACHING_PROBE(file_load_end, Tag.value, size(), payload->bytes.size());
+    }
+
+    /// @brief Dumps cache content to an associated file
+    void dump_to_file() const
+    {
+        static constexpr size_t key_val_size = Key::BinSize + bin_size_v<Value>;
+
+        CACHING_PROBE(dump_begin, Tag.value, size());
+        std::vector<std::byte> rows(size() * key_val_size);
+        std::byte* record = rows.data();
+        for (size_t row = 0; row < size(); row++, record += key_val_size)
+        {
+            size_t offset = 0;
+            [&]<size_t... I>(std::index_sequence<I...>) {
+                ((Caching::serialize_to(std::get<I>(columns)[row], record + offset), offset += bin_size_v<T>), ...);
+            }(std::index_sequence_for<T...>{});
+            Caching::serialize_to(values[row], record + Key::BinSize);
+        }
+        auto file_dump = Caching::write_records<Key, Value>(get_cache_file_name());
+        file_dump.write_rows(rows, record_fields<Key, Value>());
+        file_dump.finish(size());
+        CACHING_PROBE(dump_end, Tag.value, rows.size());
+    }
+
+    std::tuple<std::vector<T>...> columns;
+    std::vector<Value> values;
+    /// std::hash of key per row, compared before keys and reused when index is rebuilt
+    std::vector<size_t> hashes;
+    /// Row number plus one per slot, 0 marks an empty slot
+    std::vector<uint32_t> index;
+};
+
+}  // namespace Caching
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace Caching {
+
+/**
+ * Byte-oriented LZ77 block compression
+ *
+ * A block is a sequence of (token, literals, offset) groups as in LZ4: token holds literal length
+ * in high and match length minus MinMatch in low nibble, value 15 continues in following bytes
+ * summed until one is below 255, offset is 16-bit little-endian distance back into decoded output
+ * Last group carries only literals. Favors speed over ratio, suited for cache entries and dumps
+ */
+namespace lz {
+
+inline constexpr size_t MinMatch = 4;
+inline constexpr size_t MaxOffset = 65535;
+inline constexpr size_t HashBits = 12;
+
+inline void put_length(std::vector<std::byte>& out, size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        out.push_back(std::byte{255});
+    }
+    out.push_back(static_cast<std::byte>(length));
+}
+
+inline void put_group(std::vector<std::byte>& out, std::span<const std::byte> literals, size_t match, size_t offset)
+{
+    const size_t match_code = match == 0 ? 0 : match - MinMatch;
+    out.push_back(static_cast<std::byte>((std::min<size_t>(literals.size(), 15) << 4) | std::min<size_t>(match_code, 15)));
+    if (literals.size() >= 15)
+    {
+        put_length(out, literals.size() - 15);
+    }
+    out.insert(out.end(), literals.begin(), literals.end());
+    if (match == 0)
+    {
+        return;
+    }
+    out.push_back(static_cast<std::byte>(offset & 0xff));
+    out.push_back(static_cast<std::byte>(offset >> 8));
+    if (match_code >= 15)
+    {
+        put_length(out, match_code - 15);
+    }
+}
+
+inline bool get_length(std::span<const std::byte> in, size_t& pos, size_t& length)
+{
+    for (;;)
+    {
+        if (pos >= in.size())
+        {
+            return false;
+        }
+        const auto byte = static_cast<uint8_t>(in[pos++]);
+        length += byte;
+        if (byte != 255)
+        {
+            return true;
+        }
+    }
+}
+
+}  // namespace lz
+
+/// @brief Compresses bytes into an LZ block
+/// @param in bytes to compress
+/// @return compressed block, decompressing requires the original size
+inline std::vector<std::byte> compress(std::span<const std::byte> in)
+{
+    std::vector<std::byte> out;
+    out.reserve(in.size() / 2 + 16);
+    std::array<uint32_t, size_t{1} << lz::HashBits> table{};  // position plus one, zero when empty
+
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + lz::MinMatch <= in.size())
+    {
+        uint32_t sequence;
+        std::memcpy(&sequence, in.data() + pos, sizeof(sequence));
+        const size_t slot = (sequence * 2654435761u) >> (32 - lz::HashBits);
+        const size_t candidate = table[slot];
+        table[slot] = static_cast<uint32_t>(pos + 1);
+
+        if (candidate == 0 || pos - (candidate - 1) > lz::MaxOffset
+            || std::memcmp(in.data() + candidate - 1, in.data() + pos, lz::MinMatch) != 0)
+        {
+            pos++;
+            continue;
+        }
+        const size_t match = candidate - 1;
+        size_t length = lz::MinMatch;
+        while (pos + length < in.size() && in[match + length] == in[pos + length])
+        {
+            length++;
+        }
+        lz::put_group(out, in.subspan(anchor, pos - anchor), length, pos - match);
+        pos += length;
+        anchor = pos;
+    }
+    lz::put_group(out, in.subspan(anchor), 0, 0);
+    return out;
+}
+
+/// @brief Restores bytes compressed by compress
+/// @param in compressed block
+/// @param size size of original bytes
+/// @return original bytes, std::nullopt for a corrupted block
+inline std::optional<std::vector<std::byte>> decompress(std::span<const std::byte> in, size_t size)
+{
+    std::vector<std::byte> out;
+    out.reserve(size);
+    size_t pos = 0;
+    while (pos < in.size())
+    {
+        const auto token = static_cast<uint8_t>(in[pos++]);
+        size_t literals = token >> 4;
+        if (literals == 15 && !lz::get_length(in, pos, literals))
+        {
+            return std::nullopt;
+        }
+        if (literals > in.size() - pos || out.size() + literals > size)
+        {
+            return std::nullopt;
+        }
+        out.insert(out.end(), in.begin() + pos, in.begin() + pos + literals);
+        pos += literals;
+        if (pos == in.size())
+        {
+            break;
+        }
+
+        if (in.size() - pos < 2)
+        {
+            return std::nullopt;
+        }
+        const size_t offset = static_cast<size_t>(in[pos]) | (static_cast<size_t>(in[pos + 1]) << 8);
+        pos += 2;
+        size_t length = token & 15;
+        if (length == 15 && !lz::get_length(in, pos, length))
+        {
+            return std::nullopt;
+        }
+        length += lz::MinMatch;
+        if (offset == 0 || offset > out.size() || out.size() + length > size)
+        {
+            return std::nullopt;
+        }
+        // Byte by byte as a match may overlap bytes it produces
+        for (size_t from = out.size() - offset; length > 0; length--, from++)
+        {
+            out.push_back(out[from]);
+        }
+    }
+    if (out.size() != size)
+    {
+        return std::nullopt;
+    }
+    return out;
+}
+
+}  // namespace Caching
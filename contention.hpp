@@ -0,0 +1,342 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+#include "latency.hpp"
+
+namespace Caching {
+
+/// @brief Cache operations acquiring a lock
+enum class LockOperation : uint8_t
+{
+    Load,
+    Store,
+    GetOrCompute,
+    Iterate,
+    Configure,
+    Compact,
+};
+
+inline constexpr size_t LockOperationCount = 6;
+
+/// @brief Acquisition counters of one lock mode or operation, wait times in nanoseconds
+struct LockWaitStats
+{
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;
+    double total_wait_ns = 0;
+    double max_wait_ns = 0;
+};
+
+/// @brief Pathological lock usage detected while profiling
+struct ContentionEvent
+{
+    enum class Kind : uint8_t
+    {
+        LongExclusiveHold,  ///< exclusive holder kept the lock long while readers queued behind it
+        WriterStarved,      ///< exclusive acquisition waited longer than the hold threshold
+    };
+
+    Kind kind;
+    LockOperation op;       ///< operation holding or waiting for the lock
+    double duration_ns;     ///< hold or wait time
+    uint64_t blocked_readers; ///< readers that found the lock taken during the hold
+};
+
+/// @brief Snapshot of contention counters of one lock
+struct ContentionReport
+{
+    LockWaitStats shared;
+    LockWaitStats exclusive;
+    std::array<LockWaitStats, LockOperationCount> by_waiter{};  ///< indexed by operation of the waiting thread
+    std::array<LockWaitStats, LockOperationCount> by_holder{};  ///< contended waits behind exclusive holder operation
+    LockWaitStats behind_readers;                                ///< contended waits while only readers held the lock
+    uint64_t waiting = 0;                                        ///< threads blocked on the lock when the report was taken
+    /// Mean contended exclusive wait over mean contended shared wait, above 1 writers starve
+    double writer_starvation_ratio = 0;
+    std::vector<ContentionEvent> events;
+};
+
+/// @brief Limits for flagging contention events
+struct ContentionThresholds
+{
+    std::chrono::nanoseconds long_hold{std::chrono::microseconds{100}};  ///< hold or wait time considered long
+    uint64_t blocked_readers = 4;  ///< readers a long exclusive hold must block to be flagged
+};
+
+/**
+ * LockProfiler class
+ *
+ * Contention instrumentation of a single std::shared_mutex, e.g. a ConcurrentCache shard
+ * Disabled profiler takes plain locks. Enabled one tries the lock first and times only
+ * contended acquisitions, attributing waits to the waiting operation and to the operation of
+ * the exclusive holder. Counters are shared atomics, so profiling itself adds some coherence
+ * traffic and is meant for diagnosis rather than always-on use
+ */
+class LockProfiler
+{
+public:
+    /// Number of most recent events kept
+    static constexpr size_t EventCapacity = 64;
+
+    /**
+     * Exclusive lock reporting hold time to the profiler on release
+     */
+    class ExclusiveLock
+    {
+    public:
+        explicit ExclusiveLock(std::unique_lock<std::shared_mutex> lk) : lk{std::move(lk)} {}
+
+        ExclusiveLock(std::unique_lock<std::shared_mutex> lk, LockProfiler* profiler, LockOperation op, uint64_t waited)
+            : lk{std::move(lk)}, profiler{profiler}, op{op}, acquired{read_ticks()}, waited{waited},
+              readers_blocked_before{profiler->blocked_readers.load(std::memory_order_relaxed)}
+        {
+        }
+
+        ExclusiveLock(ExclusiveLock&& other) noexcept
+            : lk{std::move(other.lk)}, profiler{std::exchange(other.profiler, nullptr)}, op{other.op},
+              acquired{other.acquired}, waited{other.waited}, readers_blocked_before{other.readers_blocked_before}
+        {
+        }
+
+        ExclusiveLock& operator=(ExclusiveLock&&) = delete;
+
+        /// Unlocks before reporting, so events are recorded outside the profiled lock
+        ~ExclusiveLock()
+        {
+            if (profiler != nullptr)
+            {
+                const uint64_t held = read_ticks() - acquired;
+                profiler->exclusive_holder.store(0, std::memory_order_relaxed);
+                const uint64_t readers = profiler->blocked_readers.load(std::memory_order_relaxed) - readers_blocked_before;
+                lk = {};
+                profiler->release_exclusive(op, waited, held, readers);
+            }
+        }
+
+    private:
+        std::unique_lock<std::shared_mutex> lk;
+        LockProfiler* profiler = nullptr;
+        LockOperation op{};
+        uint64_t acquired = 0;
+        uint64_t waited = 0;
+        uint64_t readers_blocked_before = 0;
+    };
+
+    /// @brief Turns profiling on or off, counters are kept. Calibrates the tick clock, which may
+    /// sleep for a few milliseconds on the first call
+    void enable(bool on, ContentionThresholds limits = {})
+    {
+        const double ratio = ticks_per_ns();
+        tick_ratio.store(ratio, std::memory_order_relaxed);
+        long_hold.store(static_cast<uint64_t>(static_cast<double>(limits.long_hold.count()) * ratio),
+                        std::memory_order_relaxed);
+        min_blocked_readers.store(limits.blocked_readers, std::memory_order_relaxed);
+        enabled.store(on, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool is_enabled() const
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Acquires exclusive lock recording contention when enabled
+    ExclusiveLock lock_exclusive(std::shared_mutex& mtx, LockOperation op)
+    {
+        if (!is_enabled())
+        {
+            return ExclusiveLock{std::unique_lock{mtx}};
+        }
+        std::unique_lock lk{mtx, std::try_to_lock};
+        uint64_t waited = 0;
+        if (lk.owns_lock())
+        {
+            record_uncontended(exclusive, op);
+        }
+        else
+        {
+            const uint8_t holder = exclusive_holder.load(std::memory_order_relaxed);
+            const uint64_t start = read_ticks();
+            waiting.fetch_add(1, std::memory_order_relaxed);
+            lk.lock();
+            waiting.fetch_sub(1, std::memory_order_relaxed);
+            waited = read_ticks() - start;
+            record_contended(exclusive, op, holder, waited);
+        }
+        exclusive_holder.store(static_cast<uint8_t>(op) + 1, std::memory_order_relaxed);
+        return ExclusiveLock{std::move(lk), this, op, waited};
+    }
+
+    /// @brief Acquires shared lock recording contention when enabled
+    std::shared_lock<std::shared_mutex> lock_shared(std::shared_mutex& mtx, LockOperation op)
+    {
+        if (!is_enabled())
+        {
+            return std::shared_lock{mtx};
+        }
+        std::shared_lock lk{mtx, std::try_to_lock};
+        if (lk.owns_lock())
+        {
+            record_uncontended(shared, op);
+            return lk;
+        }
+        const uint8_t holder = exclusive_holder.load(std::memory_order_relaxed);
+        blocked_readers.fetch_add(1, std::memory_order_relaxed);
+        const uint64_t start = read_ticks();
+        waiting.fetch_add(1, std::memory_order_relaxed);
+        lk.lock();
+        waiting.fetch_sub(1, std::memory_order_relaxed);
+        record_contended(shared, op, holder, read_ticks() - start);
+        return lk;
+    }
+
+    /// @brief Counters converted to nanoseconds with recent events
+    [[nodiscard]] ContentionReport report() const
+    {
+        const double ratio = tick_ratio.load(std::memory_order_relaxed);
+        ContentionReport result;
+        result.shared = shared.snapshot(ratio);
+        result.exclusive = exclusive.snapshot(ratio);
+        for (size_t i = 0; i < LockOperationCount; i++)
+        {
+            result.by_waiter[i] = by_waiter[i].snapshot(ratio);
+            result.by_holder[i] = by_holder[i + 1].snapshot(ratio);
+        }
+        result.behind_readers = by_holder[0].snapshot(ratio);
+        result.waiting = waiting.load(std::memory_order_relaxed);
+
+        if (result.shared.contended > 0 && result.exclusive.contended > 0 && result.shared.total_wait_ns > 0)
+        {
+            result.writer_starvation_ratio = (result.exclusive.total_wait_ns / result.exclusive.contended)
+                                           / (result.shared.total_wait_ns / result.shared.contended);
+        }
+
+        std::lock_guard lk{events_mtx};
+        result.events.assign(events.begin(), events.end());
+        return result;
+    }
+
+    /// @brief Zeroes counters and drops events
+    void reset()
+    {
+        for (Counters* counters : {&shared, &exclusive})
+        {
+            counters->clear();
+        }
+        for (auto& counters : by_waiter)
+        {
+            counters.clear();
+        }
+        for (auto& counters : by_holder)
+        {
+            counters.clear();
+        }
+        std::lock_guard lk{events_mtx};
+        events.clear();
+    }
+
+private:
+    struct Counters
+    {
+        std::atomic<uint64_t> acquisitions = 0;
+        std::atomic<uint64_t> contended = 0;
+        std::atomic<uint64_t> total_wait = 0;
+        std::atomic<uint64_t> max_wait = 0;
+
+        void add_wait(uint64_t ticks)
+        {
+            contended.fetch_add(1, std::memory_order_relaxed);
+            total_wait.fetch_add(ticks, std::memory_order_relaxed);
+            uint64_t current = max_wait.load(std::memory_order_relaxed);
+            while (ticks > current && !max_wait.compare_exchange_weak(current, ticks, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        LockWaitStats snapshot(double ratio) const
+        {
+            return {acquisitions.load(std::memory_order_relaxed), contended.load(std::memory_order_relaxed),
+                    static_cast<double>(total_wait.load(std::memory_order_relaxed)) / ratio,
+                    static_cast<double>(max_wait.load(std::memory_order_relaxed)) / ratio};
+        }
+
+        void clear()
+        {
+            for (auto* counter : {&acquisitions, &contended, &total_wait, &max_wait})
+            {
+                counter->store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    void record_uncontended(Counters& mode, LockOperation op)
+    {
+        mode.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        by_waiter[static_cast<size_t>(op)].acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void record_contended(Counters& mode, LockOperation op, uint8_t holder, uint64_t ticks)
+    {
+        record_uncontended(mode, op);
+        mode.add_wait(ticks);
+        by_waiter[static_cast<size_t>(op)].add_wait(ticks);
+        by_holder[holder].add_wait(ticks);
+    }
+
+    /// Flags long wait and hold of an exclusive lock already released
+    void release_exclusive(LockOperation op, uint64_t waited, uint64_t held, uint64_t readers)
+    {
+        const uint64_t limit = long_hold.load(std::memory_order_relaxed);
+        const double ratio = tick_ratio.load(std::memory_order_relaxed);
+        if (waited > limit)
+        {
+            add_event({ContentionEvent::Kind::WriterStarved, op, static_cast<double>(waited) / ratio, 0});
+        }
+        if (readers >= min_blocked_readers.load(std::memory_order_relaxed) && held > limit)
+        {
+            add_event({ContentionEvent::Kind::LongExclusiveHold, op, static_cast<double>(held) / ratio, readers});
+        }
+    }
+
+    void add_event(ContentionEvent event)
+    {
+        std::lock_guard lk{events_mtx};
+        if (events.size() == EventCapacity)
+        {
+            events.pop_front();
+        }
+        events.push_back(event);
+    }
+
+    std::atomic<bool> enabled = false;
+    /// Ticks per nanosecond calibrated by enable
+    std::atomic<double> tick_ratio = 1.0;
+    /// Hold or wait threshold in ticks
+    std::atomic<uint64_t> long_hold = 0;
+    std::atomic<uint64_t> min_blocked_readers = 0;
+    /// Operation of current exclusive holder plus one, zero when unlocked or held by readers
+    std::atomic<uint8_t> exclusive_holder = 0;
+    /// Readers that found the lock taken, difference over a hold counts readers it blocked
+    std::atomic<uint64_t> blocked_readers = 0;
+    /// Threads that found the lock taken and have not acquired it yet
+    std::atomic<uint64_t> waiting = 0;
+
+    Counters shared;
+    Counters exclusive;
+    std::array<Counters, LockOperationCount> by_waiter;
+    std::array<Counters, LockOperationCount + 1> by_holder;
+
+    mutable std::mutex events_mtx;
+    std::deque<ContentionEvent> events;
+};
+
+}  // namespace Caching
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+
+#include "helpers.hpp"
+#include "persistence.hpp"
+#include "serialization.hpp"
+
+namespace Caching {
+
+/**
+ * EmbeddedDump struct
+ *
+ * Read-only cache contents compiled into the binary
+ * Records hold key and value bytes in the dump file layout and byte order ordered by hash_bytes of key bytes,
+ * a lookup is a binary search over the hash array followed by a key comparison
+ * Tables are generated from dump files by `cache-tool embed` (CMake function caching_embed_dump)
+ * or built in constant expressions with make_embedded_table
+ */
+struct EmbeddedDump
+{
+    size_t key_size = 0;
+    size_t value_size = 0;
+    size_t count = 0;
+    /// Whether stores layered on top of the table are persisted to an overlay dump file
+    bool overlay = false;
+    const uint64_t* hashes = nullptr;
+    const unsigned char* records = nullptr;
+    /// type_fingerprint of Key and Value the records were written for
+    uint64_t fingerprint = 0;
+
+    [[nodiscard]] constexpr bool present() const
+    {
+        return key_size != 0;
+    }
+
+    [[nodiscard]] constexpr size_t record_size() const
+    {
+        return key_size + value_size;
+    }
+
+    /// @brief Finds record of a key
+    /// @param key serialized key
+    /// @param hash hash_bytes of serialized key
+    /// @return pointer to record bytes or nullptr
+    [[nodiscard]] const unsigned char* find(std::span<const std::byte> key, uint64_t hash) const
+    {
+        const uint64_t* last = hashes + count;
+        for (const uint64_t* it = std::lower_bound(hashes, last, hash); it != last && *it == hash; ++it)
+        {
+            const unsigned char* record = records + (it - hashes) * record_size();
+            if (std::memcmp(record, key.data(), key_size) == 0)
+            {
+                return record;
+            }
+        }
+        return nullptr;
+    }
+};
+
+/// @brief Table of a cache, specialized by generated headers
+/// A specialization must be visible before a Cache with the Tag is used, in every translation unit using it
+template <StringLiteral Tag>
+inline constexpr EmbeddedDump embedded_dump{};
+
+/**
+ * EmbeddedTable struct
+ *
+ * Storage for an EmbeddedDump built at compile time
+ *
+ * @tparam N number of records
+ * @tparam KeySize size of serialized key
+ * @tparam ValueSize size of serialized value
+ */
+template <size_t N, size_t KeySize, size_t ValueSize>
+struct EmbeddedTable
+{
+    std::array<uint64_t, N> hashes{};
+    std::array<unsigned char, N * (KeySize + ValueSize)> records{};
+    uint64_t fingerprint = 0;
+
+    /// @param overlay whether stores on top of the table are persisted
+    [[nodiscard]] constexpr EmbeddedDump dump(bool overlay = false) const
+    {
+        return {KeySize, ValueSize, N, overlay, hashes.data(), records.data(), fingerprint};
+    }
+};
+
+/// @brief Builds table of entries in constant expressions
+/// @param entries (key, value) pairs with unique keys
+/// @return table to be exposed as embedded_dump specialization via dump()
+template <typename Key, typename Value, size_t N>
+constexpr auto make_embedded_table(const std::array<std::pair<Key, Value>, N>& entries)
+{
+    constexpr size_t key_size = Key::BinSize;
+    constexpr size_t value_size = bin_size_v<Value>;
+
+    std::array<size_t, N> order{};
+    std::array<uint64_t, N> hashes{};
+    for (size_t i = 0; i < N; i++)
+    {
+        order[i] = i;
+        auto key_bytes = Caching::serialize(entries[i].first);
+        dump_byte_order(key_bytes, key_fields<Key>());
+        hashes[i] = hash_bytes(key_bytes);
+    }
+    std::ranges::sort(order, [&](size_t lhs, size_t rhs) { return hashes[lhs] < hashes[rhs]; });
+
+    EmbeddedTable<N, key_size, value_size> table;
+    table.fingerprint = type_fingerprint<Key, Value>;
+    for (size_t i = 0; i < N; i++)
+    {
+        const auto& [key, value] = entries[order[i]];
+        table.hashes[i] = hashes[order[i]];
+        auto key_bytes = Caching::serialize(key);
+        auto value_bytes = Caching::serialize(value);
+        dump_byte_order(key_bytes, key_fields<Key>());
+        dump_byte_order(value_bytes, value_fields<Value>());
+        for (size_t b = 0; b < key_size; b++)
+        {
+            table.records[i * (key_size + value_size) + b] = static_cast<unsigned char>(key_bytes[b]);
+        }
+        for (size_t b = 0; b < value_size; b++)
+        {
+            table.records[i * (key_size + value_size) + key_size + b] = static_cast<unsigned char>(value_bytes[b]);
+        }
+    }
+    return table;
+}
+
+}  // namespace Caching
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+
+#include "serialization.hpp"
+#include "helpers.hpp"
+
+namespace Caching {
+
+/**
+ * Fingerprint class
+ *
+ * Key adapter storing only a 64 or 128-bit hash of a serialized key instead of the key itself
+ * Use as Key of Cache or ConcurrentCache to trade exactness for memory:
+ * Cache<Fingerprint<Dependances<...>>, Value>
+ *
+ * Distinct keys sharing a fingerprint are treated as equal, so a lookup may return
+ * value stored for another key. With n distinct keys ever stored the probability of
+ * any such collision is about n^2 / 2^(Bits + 1), e.g. ~2.7e-8 for 10^6 keys and
+ * 64 bits, ~1.5e-21 for 10^9 keys and 128 bits. Suitable for memoization of pure
+ * functions where a rare wrong hit is tolerable
+ *
+ * @tparam Key type of a fingerprinted key
+ * @tparam Bits fingerprint width, 64 or 128
+ */
+template <typename Key, size_t Bits = 64>
+class Fingerprint
+{
+    static_assert(Bits == 64 || Bits == 128, "Fingerprint supports 64 and 128 bit widths");
+
+    static constexpr size_t Words = Bits / 64;
+
+public:
+    static constexpr size_t BinSize = sizeof(uint64_t) * Words;
+
+    /// Fingerprinted key type, distinguishes dump files of fingerprints of different keys
+    using WrappedKey = Key;
+
+    constexpr Fingerprint() = default;
+
+    /// @brief Computes fingerprint of a key constructed from arguments
+    template <typename... Args>
+        requires std::constructible_from<Key, Args...>
+    Fingerprint(Args&&... args)
+    {
+        const auto bytes = Caching::serialize(Key(std::forward<Args>(args)...));
+        for (size_t i = 0; i < Words; i++)
+        {
+            words[i] = hash_bytes(std::as_bytes(std::span{bytes}), i);
+        }
+    }
+
+    constexpr bool operator==(const Fingerprint&) const = default;
+
+    /// @brief Upper bound of probability that any two of given number of distinct keys collide
+    static constexpr double collision_probability(double distinct_keys)
+    {
+        double space = 1.0;
+        for (size_t i = 0; i < Bits; i++)
+        {
+            space *= 2.0;
+        }
+        return distinct_keys * (distinct_keys - 1) / (2.0 * space);
+    }
+
+    [[nodiscard]] constexpr uint64_t hash() const
+    {
+        return words[0];
+    }
+
+    std::array<std::byte, BinSize> serialize() const
+    {
+        return std::bit_cast<std::array<std::byte, BinSize>>(words);
+    }
+
+    static Fingerprint deserialize(std::span<std::byte, BinSize> bytes)
+    {
+        Fingerprint fingerprint;
+        std::memcpy(fingerprint.words.data(), bytes.data(), BinSize);
+        return fingerprint;
+    }
+
+private:
+    std::array<uint64_t, Words> words{};
+};
+
+}  // namespace Caching
+
+/// @brief Hash struct overload for Fingerprint reusing already computed hash
+template <typename Key, size_t Bits>
+struct std::hash<Caching::Fingerprint<Key, Bits>>
+{
+    constexpr std::size_t operator()(const Caching::Fingerprint<Key, Bits>& fingerprint) const noexcept
+    {
+        return fingerprint.hash();
+    }
+};
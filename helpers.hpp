@@ -2,6 +2,17 @@
 
 #include <cstdint>
 #include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 
 #include "serialization.hpp"
 
@@ -21,25 +32,165 @@ struct StringLiteral {
     char value[N];
 };
 
+namespace execution {
+
+/// @brief Execution policy running iteration on the calling thread
+struct sequenced_policy {};
+
+/// @brief Execution policy splitting iteration into chunks processed by a pool of threads
+struct parallel_policy
+{
+    /// @brief Returns policy limited to given number of threads
+    /// @param count maximum number of threads to use, 0 means hardware concurrency
+    constexpr parallel_policy on(unsigned count) const { return parallel_policy{count}; }
+
+    unsigned threads = 0;
+};
+
+inline constexpr sequenced_policy seq{};
+inline constexpr parallel_policy par{};
+
+template <typename T>
+concept policy = std::same_as<std::remove_cvref_t<T>, sequenced_policy> ||
+                 std::same_as<std::remove_cvref_t<T>, parallel_policy>;
+
+}  // namespace execution
+
+/// @brief Finalization step of 64-bit hashes (MurmurHash3 fmix64)
+constexpr uint64_t hash_mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/// @brief Folds one little-endian 64-bit word into hash state
+constexpr uint64_t hash_step(uint64_t h, uint64_t word)
+{
+    return std::rotl(h ^ (word * 0x87c37b91114253d5ull), 31) * 0x4cf5ad432745937full;
+}
+
+/// @brief Hashes byte sequence, usable in constant expressions
+/// @param bytes data to hash
+/// @param seed seed selecting independent hash function
+/// @return 64-bit hash
+constexpr uint64_t hash_bytes(std::span<const std::byte> bytes, uint64_t seed = 0)
+{
+    uint64_t h = seed ^ (bytes.size() * 0x9e3779b97f4a7c15ull);
+    for (size_t offset = 0; offset < bytes.size(); offset += 8)
+    {
+        uint64_t word = 0;
+        for (size_t i = 0; i < 8 && offset + i < bytes.size(); i++)
+        {
+            word |= static_cast<uint64_t>(bytes[offset + i]) << (8 * i);
+        }
+        h = hash_step(h, word);
+    }
+    return hash_mix(h);
+}
+
 // Forward Declaration for std::hash
 template<typename ...T>
 class Dependances;
 
 }  // namespace Caching
 
-/// @brief Hash struct overload for Dependancies
+/// @brief Hash struct overload for Dependancies hashing packed serialized values
 template <typename... T>
 struct std::hash<Caching::Dependances<T...>>
 {
     constexpr std::size_t operator()(
         const Caching::Dependances<T...>& deps) const noexcept {
-        size_t result = std::numeric_limits<size_t>::max();
-        std::apply(
-            [&result](auto&&... args) {
-                ((result ^= std::hash<std::string>{}(std::to_string(args))),
-                 ...);
-            },
-            deps.get_vals());
-        return result;
+        return Caching::hash_bytes(deps.serialize());
     }
 };
+
+namespace Caching {
+
+/**
+ * HashedKey class
+ *
+ * Key bundled with its precomputed std::hash value
+ * Accepted by load, store and get_or_compute of Cache and ConcurrentCache to skip rehashing
+ * when the same key is used repeatedly. Constant keys can be hashed at compile time:
+ * static constexpr auto key = HashedKey<Key>::make({1, 2});
+ *
+ * @tparam Key type of a key
+ */
+template <typename Key>
+class HashedKey
+{
+public:
+    constexpr explicit HashedKey(const Key& key) : key{key}, key_hash{std::hash<Key>{}(key)} {}
+
+    /// @brief Wraps key with hash computed elsewhere, e.g. by hash_keys
+    /// @param hash must be equal to std::hash<Key>{}(key)
+    constexpr HashedKey(const Key& key, size_t hash) : key{key}, key_hash{hash} {}
+
+    /// @brief Creates handle with hash computed during compilation
+    static consteval HashedKey make(const Key& key)
+    {
+        return HashedKey{key};
+    }
+
+    [[nodiscard]] constexpr const Key& get() const
+    {
+        return key;
+    }
+
+    [[nodiscard]] constexpr size_t hash() const
+    {
+        return key_hash;
+    }
+
+private:
+    Key key;
+    size_t key_hash;
+};
+
+/// @brief Transparent hasher reusing hash stored in HashedKey
+/// Heterogeneous lookups take the stored hash, standard containers insert plain keys and hash
+/// them once more
+template <typename Key>
+struct KeyHash
+{
+    using is_transparent = void;
+
+    constexpr size_t operator()(const Key& key) const noexcept
+    {
+        return std::hash<Key>{}(key);
+    }
+
+    constexpr size_t operator()(const HashedKey<Key>& key) const noexcept
+    {
+        return key.hash();
+    }
+};
+
+/// @brief Transparent equality comparing keys with HashedKey handles
+template <typename Key>
+struct KeyEqual
+{
+    using is_transparent = void;
+
+    static constexpr const Key& unwrap(const Key& key)
+    {
+        return key;
+    }
+
+    static constexpr const Key& unwrap(const HashedKey<Key>& key)
+    {
+        return key.get();
+    }
+
+    template <typename L, typename R>
+    constexpr bool operator()(const L& lhs, const R& rhs) const
+    {
+        return unwrap(lhs) == unwrap(rhs);
+    }
+};
+
+}  // namespace Caching
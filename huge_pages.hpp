@@ -0,0 +1,406 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace Caching {
+
+/// @brief Strategy of obtaining huge pages for HugePageArena
+enum class HugePageMode
+{
+    Transparent,  ///< anonymous mapping advised with MADV_HUGEPAGE
+    Explicit,     ///< MAP_HUGETLB mapping from the hugetlbfs pool, falls back to Transparent
+    None          ///< regular pages, useful as a baseline
+};
+
+/**
+ * HugePageArena class
+ *
+ * Arena handing out memory from 2 MB aligned chunks backed by huge pages
+ * Allocations are bumped inside the current chunk, a chunk is reused once all
+ * its allocations are released, so node based containers keep their nodes densely
+ * packed within few TLB entries
+ */
+class HugePageArena
+{
+public:
+    static constexpr size_t HugePageSize = 2 << 20;
+
+    /// @param mode way of obtaining huge pages
+    /// @param chunk_size size of a mapping requested from the system, rounded up to HugePageSize
+    /// @param numa_node node to bind mapped memory to with mbind, binding failures are ignored
+    explicit HugePageArena(HugePageMode mode = HugePageMode::Transparent, size_t chunk_size = 32 * HugePageSize,
+                           std::optional<unsigned> numa_node = std::nullopt)
+        : mode{mode}, chunk_size{round_up(std::max<size_t>(chunk_size, 1), HugePageSize)}, numa_node{numa_node} {}
+
+    HugePageArena(const HugePageArena&) = delete;
+    HugePageArena& operator=(const HugePageArena&) = delete;
+
+    ~HugePageArena()
+    {
+        for (const Chunk& chunk : chunks)
+        {
+            ::munmap(chunk.base, chunk.size);
+        }
+    }
+
+    /// @brief Process wide arena used by default constructed HugePageAllocator
+    static HugePageArena& global()
+    {
+        static HugePageArena arena;
+        return arena;
+    }
+
+    [[nodiscard]] void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        std::lock_guard lk{mtx};
+        Chunk& chunk = chunk_for(bytes, alignment);
+        const size_t offset = round_up(chunk.offset, alignment);
+        chunk.offset = offset + bytes;
+        chunk.touched = std::max(chunk.touched, chunk.offset);
+        chunk.live += bytes;
+        return chunk.base + offset;
+    }
+
+    void deallocate(void* ptr, size_t bytes)
+    {
+        std::lock_guard lk{mtx};
+        const size_t index = locate(ptr);
+        if (index == chunks.size())
+        {
+            return;
+        }
+        Chunk& chunk = chunks[index];
+        chunk.live -= bytes;
+        if (chunk.live != 0)
+        {
+            return;
+        }
+        if (chunk.size > chunk_size)
+        {
+            ::munmap(chunk.base, chunk.size);
+            chunks.erase(chunks.begin() + index);
+            std::erase_if(by_base, [&](const auto& entry) { return entry.second == index; });
+            for (auto& entry : by_base)
+            {
+                if (entry.second > index)
+                {
+                    entry.second--;
+                }
+            }
+            if (index < current)
+            {
+                current--;
+            }
+            return;
+        }
+        chunk.offset = 0;
+    }
+
+    /// @brief Makes sure following allocations of given total size are backed by already faulted pages
+    /// @param bytes amount of memory expected to be allocated soon
+    void prefault(size_t bytes)
+    {
+        std::lock_guard lk{mtx};
+        size_t available = 0;
+        for (Chunk& chunk : chunks)
+        {
+            if (chunk.offset < chunk.size && (chunk.live == 0 || &chunk == &chunks[current]))
+            {
+                populate(chunk.base + chunk.offset, chunk.size - chunk.offset);
+                chunk.touched = chunk.size;
+                available += chunk.size - chunk.offset;
+            }
+        }
+        while (available < bytes)
+        {
+            Chunk& chunk = map_chunk(chunk_size);
+            populate(chunk.base, chunk.size);
+            chunk.touched = chunk.size;
+            available += chunk.size;
+        }
+    }
+
+    /// @brief Whether memory is in a chunk other than the current one with less than half of its
+    /// allocated range live, so moving the object out helps the chunk to empty
+    [[nodiscard]] bool sparse(const void* ptr) const
+    {
+        std::lock_guard lk{mtx};
+        const size_t index = locate(ptr);
+        return index != chunks.size() && index != current && chunks[index].live * 2 < chunks[index].offset;
+    }
+
+    /// @brief Returns pages of empty chunks to the system with MADV_DONTNEED keeping their mappings
+    /// Chunks other than the current one take no allocations until they empty, so pages past their
+    /// last allocation are returned as well
+    /// @return number of released bytes
+    size_t trim()
+    {
+        std::lock_guard lk{mtx};
+        size_t released = 0;
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            Chunk& chunk = chunks[i];
+            if (chunk.live == 0 && chunk.touched != 0)
+            {
+                const size_t bytes = chunk.huge ? chunk.size : round_up(chunk.touched, page_size());
+                ::madvise(chunk.base, bytes, MADV_DONTNEED);
+                released += bytes;
+                chunk.touched = 0;
+                continue;
+            }
+            // Huge chunks give back whole huge pages only, splitting one would not free memory
+            const size_t page = chunk.huge ? HugePageSize : page_size();
+            const size_t tail = round_up(chunk.offset, page);
+            if (i != current && chunk.live != 0 && chunk.touched > tail)
+            {
+                const size_t bytes = round_up(chunk.touched, page) - tail;
+                ::madvise(chunk.base + tail, bytes, MADV_DONTNEED);
+                released += bytes;
+                chunk.touched = tail;
+            }
+        }
+        return released;
+    }
+
+    /// @brief Whether at least one chunk was mapped with huge pages requested
+    [[nodiscard]] bool uses_huge_pages() const
+    {
+        std::lock_guard lk{mtx};
+        return std::ranges::any_of(chunks, &Chunk::huge);
+    }
+
+    /// @brief Total size of memory mapped by the arena
+    [[nodiscard]] size_t mapped_bytes() const
+    {
+        std::lock_guard lk{mtx};
+        size_t total = 0;
+        for (const Chunk& chunk : chunks)
+        {
+            total += chunk.size;
+        }
+        return total;
+    }
+
+private:
+    struct Chunk
+    {
+        std::byte* base;
+        size_t size;
+        size_t offset = 0;
+        size_t live = 0;
+        bool huge = false;
+        /// End of the range written since the chunk was last trimmed
+        size_t touched = 0;
+
+        bool contains(const void* ptr) const
+        {
+            return ptr >= base && ptr < base + size;
+        }
+    };
+
+    static constexpr size_t round_up(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    /// @brief Index of the chunk containing memory, number of chunks when none does
+    size_t locate(const void* ptr) const
+    {
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        auto it = std::ranges::upper_bound(by_base, address, {}, &std::pair<uintptr_t, size_t>::first);
+        if (it == by_base.begin() || !chunks[std::prev(it)->second].contains(ptr))
+        {
+            return chunks.size();
+        }
+        return std::prev(it)->second;
+    }
+
+    Chunk& add_chunk(const Chunk& chunk)
+    {
+        const auto address = reinterpret_cast<uintptr_t>(chunk.base);
+        by_base.reserve(chunks.size() + 1);
+        chunks.push_back(chunk);
+        by_base.insert(std::ranges::upper_bound(by_base, address, {}, &std::pair<uintptr_t, size_t>::first),
+                       {address, chunks.size() - 1});
+        return chunks.back();
+    }
+
+    Chunk& chunk_for(size_t bytes, size_t alignment)
+    {
+        auto fits = [&](const Chunk& chunk) { return round_up(chunk.offset, alignment) + bytes <= chunk.size; };
+
+        if (!chunks.empty() && fits(chunks[current]))
+        {
+            return chunks[current];
+        }
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            if (chunks[i].live == 0 && fits(chunks[i]))
+            {
+                current = i;
+                return chunks[i];
+            }
+        }
+        const size_t size = round_up(bytes + alignment, chunk_size);
+        Chunk& chunk = map_chunk(size);
+        if (size == chunk_size)
+        {
+            current = chunks.size() - 1;
+        }
+        return chunk;
+    }
+
+    Chunk& map_chunk(size_t size)
+    {
+        if (mode == HugePageMode::Explicit)
+        {
+            void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (ptr != MAP_FAILED)
+            {
+                bind(ptr, size);
+                return add_chunk(Chunk{static_cast<std::byte*>(ptr), size, 0, 0, true});
+            }
+        }
+
+        // Over-map to trim the mapping to a huge page boundary
+        void* raw = ::mmap(nullptr, size + HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+        {
+            throw std::bad_alloc{};
+        }
+        auto* begin = static_cast<std::byte*>(raw);
+        auto* aligned = reinterpret_cast<std::byte*>(round_up(reinterpret_cast<uintptr_t>(begin), HugePageSize));
+        if (aligned != begin)
+        {
+            ::munmap(begin, aligned - begin);
+        }
+        ::munmap(aligned + size, begin + size + HugePageSize - (aligned + size));
+
+        bind(aligned, size);
+        bool huge = false;
+        if (mode != HugePageMode::None)
+        {
+            huge = ::madvise(aligned, size, MADV_HUGEPAGE) == 0;
+        }
+        return add_chunk(Chunk{aligned, size, 0, 0, huge});
+    }
+
+    /// @brief Applies MPOL_BIND policy for arena node to not yet faulted mapping
+    void bind(void* begin, size_t size) const
+    {
+        static constexpr int mpol_bind = 2;
+        static constexpr size_t mask_bits = 8 * sizeof(unsigned long);
+
+        if (!numa_node || *numa_node >= 64 * mask_bits)
+        {
+            return;
+        }
+        unsigned long mask[64] = {};
+        mask[*numa_node / mask_bits] = 1ul << (*numa_node % mask_bits);
+        ::syscall(SYS_mbind, begin, size, mpol_bind, mask, 64 * mask_bits, 0);
+    }
+
+    static size_t page_size()
+    {
+        static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    static void populate(std::byte* begin, size_t size)
+    {
+#ifdef MADV_POPULATE_WRITE
+        if (::madvise(begin, size, MADV_POPULATE_WRITE) == 0)
+        {
+            return;
+        }
+#endif
+        for (size_t offset = 0; offset < size; offset += page_size())
+        {
+            *static_cast<volatile std::byte*>(begin + offset) = std::byte{0};
+        }
+    }
+
+    const HugePageMode mode;
+    const size_t chunk_size;
+    const std::optional<unsigned> numa_node;
+    std::vector<Chunk> chunks;
+    /// Chunk bases sorted by address with chunk indices, to find the chunk of a pointer
+    std::vector<std::pair<uintptr_t, size_t>> by_base;
+    size_t current = 0;
+    mutable std::mutex mtx;
+};
+
+/**
+ * HugePageAllocator class
+ *
+ * Standard allocator drawing memory from HugePageArena
+ * Pass as Allocator template argument of Cache to back its table with huge pages
+ *
+ * @tparam T type of allocated objects
+ */
+template <typename T>
+class HugePageAllocator
+{
+public:
+    using value_type = T;
+
+    HugePageAllocator() noexcept : arena{&HugePageArena::global()} {}
+    explicit HugePageAllocator(HugePageArena& arena) noexcept : arena{&arena} {}
+
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U>& other) noexcept : arena{other.arena} {}
+
+    [[nodiscard]] T* allocate(size_t n)
+    {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept
+    {
+        arena->deallocate(ptr, n * sizeof(T));
+    }
+
+    /// @brief Prefaults arena pages for expected allocations, used by Cache on load
+    void prefault(size_t bytes) const
+    {
+        arena->prefault(bytes);
+    }
+
+    /// @brief Whether object lies in a sparsely used arena chunk, used by Cache::compact
+    [[nodiscard]] bool sparse(const void* ptr) const
+    {
+        return arena->sparse(ptr);
+    }
+
+    /// @brief Releases pages of empty arena chunks, used by Cache::compact
+    size_t trim() const
+    {
+        return arena->trim();
+    }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U>& other) const noexcept
+    {
+        return arena == other.arena;
+    }
+
+private:
+    template <typename U>
+    friend class HugePageAllocator;
+
+    HugePageArena* arena;
+};
+
+}  // namespace Caching
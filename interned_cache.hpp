@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "serialization.hpp"
+#include "helpers.hpp"
+#include "persistence.hpp"
+
+namespace Caching {
+
+/**
+ * ValuePool class
+ *
+ * Content-addressed store of values
+ * Equal values (compared by serialized bytes) are stored once and shared through
+ * refcounted handles, a value is released with the last handle referring to it
+ * Bookkeeping of released values is dropped by periodic collection during interning
+ *
+ * @tparam Value type of pooled values
+ */
+template <typename Value>
+class ValuePool
+{
+public:
+    using Handle = std::shared_ptr<const Value>;
+
+    /// @brief Returns handle to pooled value equal to given one, adding it if absent
+    /// @param value value to intern
+    /// @return shared handle
+    template <typename V>
+    Handle intern(V&& value)
+    {
+        // Buckets of released values never interned again are collected whenever the pool doubles
+        // since the last collection, keeping bookkeeping proportional to live values
+        if (pool.size() >= collect_at)
+        {
+            collect();
+        }
+        const auto bytes = Caching::serialize(value);
+        auto& bucket = pool[hash_bytes(std::as_bytes(std::span{bytes}))];
+        std::erase_if(bucket, [](const auto& weak) { return weak.expired(); });
+        for (const auto& weak : bucket)
+        {
+            if (Handle handle = weak.lock(); handle && Caching::serialize(*handle) == bytes)
+            {
+                return handle;
+            }
+        }
+        // Separate allocation so weak handles do not keep released value alive
+        Handle handle{new Value(std::forward<V>(value))};
+        bucket.push_back(handle);
+        return handle;
+    }
+
+    /// @brief Drops bookkeeping of released values
+    void collect()
+    {
+        for (auto it = pool.begin(); it != pool.end();)
+        {
+            std::erase_if(it->second, [](const auto& weak) { return weak.expired(); });
+            it = it->second.empty() ? pool.erase(it) : std::next(it);
+        }
+        collect_at = 2 * pool.size() + 16;
+    }
+
+    /// @brief Number of distinct live values
+    [[nodiscard]] size_t size() const
+    {
+        size_t count = 0;
+        for (const auto& [hash, bucket] : pool)
+        {
+            count += std::ranges::count_if(bucket, [](const auto& weak) { return !weak.expired(); });
+        }
+        return count;
+    }
+
+    /// @brief Number of tracked values including released ones not collected yet
+    [[nodiscard]] size_t tracked() const
+    {
+        size_t count = 0;
+        for (const auto& [hash, bucket] : pool)
+        {
+            count += bucket.size();
+        }
+        return count;
+    }
+
+private:
+    std::unordered_map<uint64_t, std::vector<std::weak_ptr<const Value>>> pool;
+    /// Pool size triggering the next collection
+    size_t collect_at = 16;
+};
+
+/**
+ * InternedCache class
+ *
+ * Implements caching for highly redundant values
+ * Entries hold handles into ValuePool, so identical values stored under different keys
+ * occupy memory once. Dump contains every distinct value once followed by entries
+ * referencing values by index
+ *
+ * @tparam Key type of a key for internal std::unordered_map
+ * @tparam Value type of cached values
+ * @tparam Tag file tag string for identificaion
+ */
+template <typename Key, typename Value, StringLiteral Tag = "">
+class InternedCache
+{
+public:
+    using Handle = typename ValuePool<Value>::Handle;
+
+    InternedCache()
+    {
+        load_from_file();
+    }
+
+    ~InternedCache()
+    {
+        dump_to_file();
+    }
+
+    /// @brief Getter for file name for cache dump
+    /// @return name of an associated file
+    static const std::string& get_cache_file_name()
+    {
+        static const std::string file_name = Caching::cache_file_name<Key, Value, Tag>("interned");
+        return file_name;
+    }
+
+    /// @brief Obtaines copy of value by provided key if present
+    /// @param key key for value
+    /// @return std::optional for value
+    [[nodiscard]] std::optional<Value> load(const Key& key) const
+    {
+        if (auto it = storage.find(key); it != storage.end())
+        {
+            return *it->second;
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Obtaines shared handle to value by provided key avoiding copy
+    /// @param key key for value
+    /// @return handle to value or nullptr if absent
+    [[nodiscard]] Handle load_shared(const Key& key) const
+    {
+        if (auto it = storage.find(key); it != storage.end())
+        {
+            return it->second;
+        }
+        return nullptr;
+    }
+
+    /// @brief Saves value to the cache sharing it with equal already cached values
+    /// @tparam V type for value. Required for perfect forwarding
+    /// @param deps key for storing value
+    /// @param value value to store at key
+    template <typename V>
+    void store(const Key& deps, V&& value)
+    {
+        storage[deps] = values.intern(std::forward<V>(value));
+    }
+
+    /// @brief Number of cached entries
+    [[nodiscard]] size_t size() const
+    {
+        return storage.size();
+    }
+
+    /// @brief Number of distinct cached values
+    [[nodiscard]] size_t unique_values() const
+    {
+        return values.size();
+    }
+
+    /// @brief Invokes function for every cached entry
+    /// @param fn callable accepting (const Key&, const Value&)
+    template <typename F>
+    void for_each(F&& fn) const
+    {
+        for (const auto& [key, value] : storage)
+        {
+            std::invoke(fn, key, *value);
+        }
+    }
+
+protected:
+    /// @brief Restores values table and entries referencing it from an associated file
+    void load_from_file()
+    {
+        auto payload = Caching::read_dump(get_cache_file_name(), make_dump_header<Key, Value>(fingerprint));
+        uint64_t value_count = 0;
+        if (!payload || payload->bytes.size() < sizeof(value_count))
+        {
+            return;
+        }
+        std::memcpy(&value_count, payload->bytes.data(), sizeof(value_count));
+        dump_byte_order(std::as_writable_bytes(std::span{&value_count, 1}), value_fields<uint64_t>());
+        static constexpr size_t record_size = Key::BinSize + sizeof(uint64_t);
+        const size_t table_size = value_count * bin_size_v<Value>;
+        if (payload->bytes.size() != sizeof(value_count) + table_size + payload->count * record_size)
+        {
+            return;
+        }
+        const std::span<std::byte> table{payload->bytes.data() + sizeof(value_count), table_size};
+        dump_byte_order(table, value_fields<Value>());
+        dump_byte_order(std::span{table.data() + table_size, payload->count * record_size}, record_fields<Key, uint64_t>());
+
+        std::vector<Handle> handles;
+        handles.reserve(value_count);
+        std::byte* ptr = payload->bytes.data() + sizeof(value_count);
+        for (uint64_t i = 0; i < value_count; i++, ptr += bin_size_v<Value>)
+        {
+            handles.push_back(values.intern(
+                Caching::deserialize<Value>(std::span<std::byte, bin_size_v<Value>>{ptr, bin_size_v<Value>})));
+        }
+
+        for (size_t i = 0; i < payload->count; i++, ptr += record_size)
+        {
+            uint64_t index = 0;
+            std::memcpy(&index, ptr + Key::BinSize, sizeof(index));
+            if (index < handles.size())
+            {
+                storage[Caching::deserialize<Key>(std::span<std::byte, Key::BinSize>{ptr, Key::BinSize})] =
+                    handles[index];
+            }
+        }
+    }
+
+    /// @brief Dumps each distinct value once followed by (key, value index) records
+    void dump_to_file()
+    {
+        std::unordered_map<const Value*, uint64_t> indices;
+        std::vector<const Value*> unique;
+        for (const auto& [key, value] : storage)
+        {
+            if (indices.try_emplace(value.get(), unique.size()).second)
+            {
+                unique.push_back(value.get());
+            }
+        }
+
+        uint64_t value_count = unique.size();
+        std::vector<std::byte> table;
+        table.reserve(unique.size() * bin_size_v<Value>);
+        for (const Value* value : unique)
+        {
+            const auto bin_value = Caching::serialize(*value);
+            table.insert(table.end(), bin_value.begin(), bin_value.end());
+        }
+        std::vector<std::byte> records;
+        records.reserve(storage.size() * (Key::BinSize + sizeof(uint64_t)));
+        for (const auto& [key, value] : storage)
+        {
+            const auto bin_key = Caching::serialize(key);
+            const auto bin_index = Caching::serialize(indices.at(value.get()));
+            records.insert(records.end(), bin_key.begin(), bin_key.end());
+            records.insert(records.end(), bin_index.begin(), bin_index.end());
+        }
+
+        DumpWriter file_dump{get_cache_file_name(), make_dump_header<Key, Value>(fingerprint), dump_layout<Key, Value>()};
+        file_dump.write_rows(std::as_writable_bytes(std::span{&value_count, 1}), value_fields<uint64_t>());
+        file_dump.write_rows(table, value_fields<Value>());
+        file_dump.write_rows(records, record_fields<Key, uint64_t>());
+        file_dump.finish(storage.size());
+    }
+
+    /// Interned dumps hold a values table before records, distinct from plain dumps of the same types
+    static constexpr uint64_t fingerprint = hash_mix(type_fingerprint<Key, Value> ^ 0x696e7465726e6564ull);
+
+    std::unordered_map<Key, Handle> storage;
+    ValuePool<Value> values;
+};
+
+}  // namespace Caching
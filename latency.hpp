@@ -0,0 +1,403 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CACHING_LATENCY_TSC 1
+#endif
+
+#include "helpers.hpp"
+
+namespace Caching {
+
+/// @brief Timed cache operations
+enum class Operation : uint8_t
+{
+    Load,
+    Store,
+    LockWait,
+    GetOrCompute,
+};
+
+inline constexpr size_t OperationCount = 4;
+
+/// @brief Reads timestamp counter, constant rate TSC is assumed on x86, nanoseconds elsewhere
+inline uint64_t read_ticks()
+{
+#ifdef CACHING_LATENCY_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/// @brief Number of ticks per nanosecond, calibrated against steady_clock on first call
+inline double ticks_per_ns()
+{
+#ifdef CACHING_LATENCY_TSC
+    static const double ratio = [] {
+        using clock = std::chrono::steady_clock;
+        const auto wall_start = clock::now();
+        const uint64_t ticks_start = read_ticks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const uint64_t ticks_end = read_ticks();
+        const auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - wall_start).count();
+        return static_cast<double>(ticks_end - ticks_start) / static_cast<double>(wall_ns);
+    }();
+    return ratio;
+#else
+    return 1.0;
+#endif
+}
+
+/**
+ * LatencyHistogram class
+ *
+ * HDR-style log-linear histogram: every power of two range is split into SubBuckets linear
+ * buckets, so a recorded value is reproduced within 1 / SubBuckets relative error
+ * Counters are atomics written by a single owner thread and read by any thread merging them
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr size_t SubBits = 5;
+    static constexpr size_t SubBuckets = size_t{1} << SubBits;
+    static constexpr size_t Buckets = (64 - SubBits + 1) * SubBuckets;
+
+    LatencyHistogram() = default;
+
+    LatencyHistogram(const LatencyHistogram& other)
+    {
+        merge(other);
+    }
+
+    LatencyHistogram& operator=(const LatencyHistogram& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            merge(other);
+        }
+        return *this;
+    }
+
+    /// @brief Bucket holding a value
+    static constexpr size_t bucket_index(uint64_t value)
+    {
+        if (value < SubBuckets)
+        {
+            return value;
+        }
+        const size_t exponent = std::bit_width(value) - 1;
+        const size_t sub = (value >> (exponent - SubBits)) & (SubBuckets - 1);
+        return (exponent - SubBits + 1) * SubBuckets + sub;
+    }
+
+    /// @brief Highest value falling into a bucket
+    static constexpr uint64_t bucket_upper_bound(size_t index)
+    {
+        if (index < SubBuckets)
+        {
+            return index;
+        }
+        const size_t shift = index / SubBuckets - 1;
+        const uint64_t lower = (SubBuckets + index % SubBuckets) << shift;
+        return lower + ((uint64_t{1} << shift) - 1);
+    }
+
+    /// @brief Adds a value, must only be called by the owner thread
+    void record(uint64_t value)
+    {
+        bump(counts[bucket_index(value)], 1);
+        bump(total, 1);
+        if (value > maximum.load(std::memory_order_relaxed))
+        {
+            maximum.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Adds counts of another histogram
+    void merge(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i < Buckets; i++)
+        {
+            if (const uint64_t count = other.counts[i].load(std::memory_order_relaxed))
+            {
+                bump(counts[i], count);
+            }
+        }
+        bump(total, other.total.load(std::memory_order_relaxed));
+        if (const uint64_t other_max = other.maximum.load(std::memory_order_relaxed);
+            other_max > maximum.load(std::memory_order_relaxed))
+        {
+            maximum.store(other_max, std::memory_order_relaxed);
+        }
+    }
+
+    void clear()
+    {
+        for (auto& count : counts)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+        total.store(0, std::memory_order_relaxed);
+        maximum.store(0, std::memory_order_relaxed);
+    }
+
+    /// @brief Number of recorded values
+    [[nodiscard]] uint64_t count() const
+    {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Largest recorded value
+    [[nodiscard]] uint64_t max() const
+    {
+        return maximum.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Smallest bucket bound not exceeded by given fraction of recorded values
+    /// @param quantile fraction in [0, 1], e.g. 0.999
+    [[nodiscard]] uint64_t value_at_quantile(double quantile) const
+    {
+        const uint64_t recorded = count();
+        if (recorded == 0)
+        {
+            return 0;
+        }
+        const auto rank = std::max<uint64_t>(static_cast<uint64_t>(quantile * static_cast<double>(recorded) + 0.5), 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < Buckets; i++)
+        {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+            {
+                return std::min(bucket_upper_bound(i), max());
+            }
+        }
+        return max();
+    }
+
+private:
+    static void bump(std::atomic<uint64_t>& counter, uint64_t by)
+    {
+        // Single writer, plain load and store avoid locked read-modify-write
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, Buckets> counts{};
+    std::atomic<uint64_t> total = 0;
+    std::atomic<uint64_t> maximum = 0;
+};
+
+/// @brief Latency percentiles of one operation in nanoseconds
+struct LatencyReport
+{
+    uint64_t count = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+};
+
+/**
+ * LatencyStats class
+ *
+ * Per Tag latency histograms of cache operations shared by all caches with the Tag
+ * Each thread records into its own histograms, they are merged when a report is requested
+ * and folded into histograms of exited threads when their thread exits
+ * Recording is disabled by default, set_sampling(n) times every n-th operation of a thread
+ *
+ * @tparam Tag file tag string of caches
+ */
+template <StringLiteral Tag = "">
+class LatencyStats
+{
+public:
+    /// @brief Enables timing of every n-th operation per thread
+    /// @param every sampling period, 1 times every operation, 0 disables recording
+    static void set_sampling(uint32_t every)
+    {
+        sample_every.store(every, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] static uint32_t sampling()
+    {
+        return sample_every.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Decides whether the current operation of calling thread is timed
+    static bool sample(Operation op)
+    {
+        const uint32_t every = sample_every.load(std::memory_order_relaxed);
+        if (every == 0)
+        {
+            return false;
+        }
+        uint32_t& skipped_ops = skipped[static_cast<size_t>(op)];
+        if (++skipped_ops < every)
+        {
+            return false;
+        }
+        skipped_ops = 0;
+        return true;
+    }
+
+    /// @brief Records operation latency into histogram of calling thread
+    static void record(Operation op, uint64_t ticks)
+    {
+        ThreadState& state = thread_state();
+        if (!state.histograms)
+        {
+            state.histograms = std::make_unique<Histograms>();
+            std::lock_guard lk{registry().mtx};
+            registry().threads.push_back(state.histograms.get());
+        }
+        (*state.histograms)[static_cast<size_t>(op)].record(ticks);
+    }
+
+    /// @brief Histogram of operation merged over all threads, values in ticks
+    [[nodiscard]] static LatencyHistogram merged(Operation op)
+    {
+        LatencyHistogram result;
+        std::lock_guard lk{registry().mtx};
+        result.merge(registry().retired[static_cast<size_t>(op)]);
+        for (const Histograms* histograms : registry().threads)
+        {
+            result.merge((*histograms)[static_cast<size_t>(op)]);
+        }
+        return result;
+    }
+
+    /// @brief Percentiles of operation latency merged over all threads
+    [[nodiscard]] static LatencyReport report(Operation op)
+    {
+        const LatencyHistogram histogram = merged(op);
+        const double ratio = ticks_per_ns();
+        auto ns = [&](uint64_t ticks) { return static_cast<double>(ticks) / ratio; };
+        return {histogram.count(), ns(histogram.value_at_quantile(0.5)), ns(histogram.value_at_quantile(0.99)),
+                ns(histogram.value_at_quantile(0.999)), ns(histogram.max())};
+    }
+
+    /// @brief Clears recorded values of all threads, values recorded concurrently may survive
+    static void reset()
+    {
+        std::lock_guard lk{registry().mtx};
+        for (auto& histogram : registry().retired)
+        {
+            histogram.clear();
+        }
+        for (Histograms* histograms : registry().threads)
+        {
+            for (auto& histogram : *histograms)
+            {
+                histogram.clear();
+            }
+        }
+    }
+
+    /// @brief Number of live threads owning histograms
+    [[nodiscard]] static size_t recording_threads()
+    {
+        std::lock_guard lk{registry().mtx};
+        return registry().threads.size();
+    }
+
+private:
+    using Histograms = std::array<LatencyHistogram, OperationCount>;
+
+    /// Owns histograms of a thread and merges them into retired ones when the thread exits
+    /// Thread locals are destroyed before statics, so the registry is still alive at that point
+    struct ThreadState
+    {
+        ThreadState() = default;
+        ThreadState(const ThreadState&) = delete;
+        ThreadState& operator=(const ThreadState&) = delete;
+
+        ~ThreadState()
+        {
+            if (!histograms)
+            {
+                return;
+            }
+            Registry& reg = registry();
+            std::lock_guard lk{reg.mtx};
+            for (size_t op = 0; op < OperationCount; op++)
+            {
+                reg.retired[op].merge((*histograms)[op]);
+            }
+            std::erase(reg.threads, histograms.get());
+        }
+
+        std::unique_ptr<Histograms> histograms;
+    };
+
+    /// Histograms of live threads and the accumulated ones of exited threads
+    struct Registry
+    {
+        std::mutex mtx;
+        std::vector<Histograms*> threads;
+        /// Written under mtx only, so single writer merging holds
+        Histograms retired;
+    };
+
+    static ThreadState& thread_state()
+    {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    static Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    static inline constinit std::atomic<uint32_t> sample_every = 0;
+    /// Counted per operation as nested timers would otherwise sample the same operation every time
+    /// Trivial thread_local without dynamic initialization keeps the unsampled path free of TLS guards
+    static inline constinit thread_local std::array<uint32_t, OperationCount> skipped{};
+};
+
+/**
+ * LatencyTimer class
+ *
+ * Scoped timer recording its lifetime into LatencyStats when the operation is sampled
+ *
+ * @tparam Tag file tag string of caches
+ */
+template <StringLiteral Tag = "">
+class LatencyTimer
+{
+public:
+    explicit LatencyTimer(Operation op) : op{op}, start{LatencyStats<Tag>::sample(op) ? read_ticks() : 0} {}
+
+    LatencyTimer(const LatencyTimer&) = delete;
+    LatencyTimer& operator=(const LatencyTimer&) = delete;
+
+    ~LatencyTimer()
+    {
+        if (start != 0)
+        {
+            LatencyStats<Tag>::record(op, read_ticks() - start);
+        }
+    }
+
+private:
+    Operation op;
+    uint64_t start;
+};
+
+}  // namespace Caching
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <sched.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "serialization.hpp"
+#include "helpers.hpp"
+#include "persistence.hpp"
+#include "huge_pages.hpp"
+
+namespace Caching {
+
+/**
+ * NumaTopology class
+ *
+ * Maps CPUs to NUMA nodes without libnuma
+ * Either parsed from /sys/devices/system/node or emulated for testing on single node machines
+ */
+class NumaTopology
+{
+public:
+    /// @brief Reads topology from sysfs, falls back to single node
+    static NumaTopology detect()
+    {
+        NumaTopology topology;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator{"/sys/devices/system/node", ec})
+        {
+            const std::string name = entry.path().filename().string();
+            unsigned node = 0;
+            if (!name.starts_with("node") ||
+                std::from_chars(name.data() + 4, name.data() + name.size(), node).ec != std::errc{})
+            {
+                continue;
+            }
+            std::ifstream cpulist{entry.path() / "cpulist"};
+            std::string list;
+            std::getline(cpulist, list);
+            for (unsigned cpu : parse_cpu_list(list))
+            {
+                topology.assign(cpu, node);
+            }
+            topology.nodes = std::max(topology.nodes, node + 1);
+        }
+        if (topology.nodes == 0)
+        {
+            return emulated(1);
+        }
+        topology.emulation = false;
+        return topology;
+    }
+
+    /// @brief Creates topology distributing CPUs round-robin over given number of nodes
+    /// @param node_count number of emulated nodes
+    static NumaTopology emulated(unsigned node_count)
+    {
+        NumaTopology topology;
+        topology.nodes = std::max(node_count, 1u);
+        const unsigned cpus = std::max(std::thread::hardware_concurrency(), 1u);
+        for (unsigned cpu = 0; cpu < cpus; cpu++)
+        {
+            topology.assign(cpu, cpu % topology.nodes);
+        }
+        return topology;
+    }
+
+    /// @brief Parses sysfs cpu list like "0-3,8,10-11"
+    static std::vector<unsigned> parse_cpu_list(std::string_view list)
+    {
+        std::vector<unsigned> cpus;
+        while (!list.empty())
+        {
+            const auto comma = list.find(',');
+            const std::string_view range = list.substr(0, comma);
+            list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+            unsigned first = 0;
+            unsigned last = 0;
+            auto [ptr, ec] = std::from_chars(range.data(), range.data() + range.size(), first);
+            if (ec != std::errc{})
+            {
+                continue;
+            }
+            last = first;
+            if (ptr != range.data() + range.size() && *ptr == '-')
+            {
+                std::from_chars(ptr + 1, range.data() + range.size(), last);
+            }
+            for (unsigned cpu = first; cpu <= last; cpu++)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    [[nodiscard]] unsigned node_count() const
+    {
+        return nodes;
+    }
+
+    [[nodiscard]] bool emulated() const
+    {
+        return emulation;
+    }
+
+    /// @brief Node of a CPU, CPUs unknown to topology belong to node 0
+    [[nodiscard]] unsigned node_of_cpu(unsigned cpu) const
+    {
+        return cpu < cpu_nodes.size() ? cpu_nodes[cpu] : 0;
+    }
+
+    /// @brief Node of a CPU the calling thread currently runs on
+    [[nodiscard]] unsigned current_node() const
+    {
+        const int cpu = ::sched_getcpu();
+        return cpu < 0 ? 0 : node_of_cpu(static_cast<unsigned>(cpu));
+    }
+
+private:
+    void assign(unsigned cpu, unsigned node)
+    {
+        if (cpu >= cpu_nodes.size())
+        {
+            cpu_nodes.resize(cpu + 1, 0);
+        }
+        cpu_nodes[cpu] = node;
+    }
+
+    std::vector<unsigned> cpu_nodes;
+    unsigned nodes = 0;
+    bool emulation = true;
+};
+
+/**
+ * ReplicatedCache class
+ *
+ * Read-mostly cache keeping one replica per NUMA node
+ * Every replica lives in a HugePageArena bound to its node, readers use replica of the
+ * node they run on. Stores are queued and propagated to all replicas in batches, so a
+ * stored value becomes visible after flush or once batch_size stores accumulate
+ *
+ * @tparam Key type of a key
+ * @tparam Value type of cached values
+ * @tparam Tag file tag string for identificaion
+ */
+template <typename Key, typename Value, StringLiteral Tag = "">
+class ReplicatedCache
+{
+public:
+    /// @param topology NUMA topology, NumaTopology::emulated allows testing on single node machines
+    /// @param batch_size number of queued stores triggering propagation to replicas
+    explicit ReplicatedCache(NumaTopology topology = NumaTopology::detect(), size_t batch_size = 64)
+        : topology{std::move(topology)}, batch_size{std::max<size_t>(batch_size, 1)}
+    {
+        for (unsigned node = 0; node < this->topology.node_count(); node++)
+        {
+            replicas.push_back(std::make_unique<Replica>(node, this->topology.emulated()));
+        }
+        load_from_file();
+    }
+
+    ~ReplicatedCache()
+    {
+        flush();
+        dump_to_file();
+    }
+
+    /// @brief Getter for file name for cache dump
+    /// @return name of an associated file
+    static const std::string& get_cache_file_name()
+    {
+        static const std::string file_name = Caching::cache_file_name<Key, Value, Tag>();
+        return file_name;
+    }
+
+    /// @brief Obtaines value from replica of the current node
+    /// @param key key for value
+    /// @return std::optional for value
+    [[nodiscard]] std::optional<Value> load(const Key& key) const
+    {
+        return load_on(topology.current_node(), key);
+    }
+
+    /// @brief Obtaines value from replica of given node
+    /// @param node node index less than node_count
+    /// @param key key for value
+    /// @return std::optional for value
+    [[nodiscard]] std::optional<Value> load_on(unsigned node, const Key& key) const
+    {
+        const Replica& replica = *replicas[node];
+        std::shared_lock lk{replica.mtx};
+        if (auto it = replica.storage.find(key); it != replica.storage.end())
+        {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Queues value for storing into all replicas
+    /// @tparam V type for value. Required for perfect forwarding
+    /// @param deps key for storing value
+    /// @param value value to store at key
+    template <typename V>
+    void store(const Key& deps, V&& value)
+    {
+        std::unique_lock lk{pending_mtx};
+        pending.emplace_back(deps, std::forward<V>(value));
+        if (pending.size() >= batch_size)
+        {
+            propagate(std::exchange(pending, {}));
+        }
+    }
+
+    /// @brief Propagates queued stores to all replicas
+    void flush()
+    {
+        std::unique_lock lk{pending_mtx};
+        propagate(std::exchange(pending, {}));
+    }
+
+    [[nodiscard]] unsigned node_count() const
+    {
+        return topology.node_count();
+    }
+
+    /// @brief Number of entries in replica of the current node
+    [[nodiscard]] size_t size() const
+    {
+        const Replica& replica = *replicas[topology.current_node()];
+        std::shared_lock lk{replica.mtx};
+        return replica.storage.size();
+    }
+
+protected:
+    using Allocator = HugePageAllocator<std::pair<const Key, Value>>;
+
+    struct alignas(64) Replica
+    {
+        Replica(unsigned node, bool emulated)
+            : arena{HugePageMode::Transparent, HugePageArena::HugePageSize, emulated ? std::nullopt : std::optional{node}},
+              storage{Allocator{arena}} {}
+
+        HugePageArena arena;
+        std::unordered_map<Key, Value, std::hash<Key>, std::equal_to<Key>, Allocator> storage;
+        mutable std::shared_mutex mtx;
+    };
+
+    /// @brief Applies batch to every replica, called with pending_mtx held to keep batches ordered
+    void propagate(std::vector<std::pair<Key, Value>> batch)
+    {
+        if (batch.empty())
+        {
+            return;
+        }
+        for (auto& replica : replicas)
+        {
+            std::unique_lock lk{replica->mtx};
+            for (const auto& [key, value] : batch)
+            {
+                replica->storage[key] = value;
+            }
+        }
+    }
+
+    /// @brief Restores data from an associated file into every replica
+    void load_from_file()
+    {
+        static constexpr size_t key_val_size = Key::BinSize + bin_size_v<Value>;
+
+        auto payload = Caching::read_records<Key, Value>(get_cache_file_name());
+        if (!payload)
+        {
+            return;
+        }
+        std::vector<std::pair<Key, Value>> batch;
+        batch.reserve(payload->count);
+        std::byte* record = payload->bytes.data();
+        for (size_t i = 0; i < payload->count; i++, record += key_val_size)
+        {
+            batch.emplace_back(
+                Caching::deserialize<Key>(std::span<std::byte, Key::BinSize>{record, Key::BinSize}),
+                Caching::deserialize<Value>(
+                    std::span<std::byte, bin_size_v<Value>>{record + Key::BinSize, bin_size_v<Value>}));
+        }
+        for (auto& replica : replicas)
+        {
+            replica->arena.prefault(batch.size() * (sizeof(std::pair<const Key, Value>) + 3 * sizeof(void*)));
+        }
+        propagate(std::move(batch));
+    }
+
+    /// @brief Dumps content of the first replica to an associated file
+    void dump_to_file() const
+    {
+        std::vector<std::byte> rows;
+        {
+            std::shared_lock lk{replicas.front()->mtx};
+            rows.resize(replicas.front()->storage.size() * (Key::BinSize + bin_size_v<Value>));
+            std::byte* record = rows.data();
+            for (const auto& [key, value] : replicas.front()->storage)
+            {
+                Caching::serialize_to(key, record);
+                Caching::serialize_to(value, record + Key::BinSize);
+                record += Key::BinSize + bin_size_v<Value>;
+            }
+        }
+        auto file_dump = Caching::write_records<Key, Value>(get_cache_file_name());
+        file_dump.write_rows(rows, record_fields<Key, Value>());
+        file_dump.finish(rows.size() / (Key::BinSize + bin_size_v<Value>));
+    }
+
+    const NumaTopology topology;
+    const size_t batch_size;
+    std::vector<std::unique_ptr<Replica>> replicas;
+    std::mutex pending_mtx;
+    std::vector<std::pair<Key, Value>> pending;
+};
+
+}  // namespace Caching
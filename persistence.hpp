@@ -0,0 +1,935 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "helpers.hpp"
+
+namespace Caching {
+
+/**
+ * Dump file format shared by all caches
+ *
+ * A dump is a DumpHeader, a layout string naming record fields as cache-tool does ("i,d:f")
+ * and a payload of serialized entries. The header carries a structural fingerprint of key and
+ * value types built from kinds and sizes of their fields and optional schema versions, so a
+ * dump survives rebuilds and compiler changes while a file written for other types is rejected
+ * by comparing the header alone. Keys storing a digest of another key add its fingerprint
+ * Arithmetic fields are stored little-endian whatever the host, opaque fields in host byte order,
+ * fixed structures of the format (headers, store directory) are converted field by field as well
+ * Dumps of record payloads may append AccessStats of every record, marked by DumpAccessStats flag
+ */
+
+/// @brief Version of a type's meaning mixed into dump fingerprints
+/// Specialize and bump when a type changes meaning without changing field kinds and sizes,
+/// e.g. a struct value reordering members of the same size
+template <typename T>
+inline constexpr uint32_t schema_version = 0;
+
+/// Field of a record: code of an arithmetic type as used by cache-tool, 0 for opaque bytes
+struct DumpField
+{
+    char code = 0;
+    size_t size = 0;
+};
+
+/// @brief Code of an arithmetic type, 0 for types dumped as opaque bytes
+template <typename T>
+constexpr char field_code()
+{
+    using U = std::remove_cv_t<T>;
+    if constexpr (std::same_as<U, bool>) return 'b';
+    else if constexpr (std::same_as<U, char>) return 'c';
+    else if constexpr (std::same_as<U, signed char>) return 'a';
+    else if constexpr (std::same_as<U, unsigned char>) return 'h';
+    else if constexpr (std::same_as<U, short>) return 's';
+    else if constexpr (std::same_as<U, unsigned short>) return 't';
+    else if constexpr (std::same_as<U, int>) return 'i';
+    else if constexpr (std::same_as<U, unsigned>) return 'j';
+    else if constexpr (std::same_as<U, long>) return 'l';
+    else if constexpr (std::same_as<U, unsigned long>) return 'm';
+    else if constexpr (std::same_as<U, long long>) return 'x';
+    else if constexpr (std::same_as<U, unsigned long long>) return 'y';
+    else if constexpr (std::same_as<U, float>) return 'f';
+    else if constexpr (std::same_as<U, double>) return 'd';
+    else return 0;
+}
+
+/// @brief Structural kind of a field code: bool, char, signed, unsigned, floating or opaque
+/// Types of equal kind and size share a fingerprint, e.g. long and long long on LP64
+constexpr char field_kind(char code)
+{
+    switch (code)
+    {
+    case 'b': case 'c': return code;
+    case 'a': case 's': case 'i': case 'l': case 'x': return 'i';
+    case 'h': case 't': case 'j': case 'm': case 'y': return 'u';
+    case 'f': case 'd': return 'f';
+    default: return 'o';
+    }
+}
+
+/// @brief Fingerprint of a record layout
+/// @param key fields of a key in serialization order
+/// @param value field of a value
+/// @param key_version schema version of the key type
+/// @param value_version schema version of the value type
+constexpr uint64_t layout_fingerprint(std::span<const DumpField> key, DumpField value, uint32_t key_version = 0,
+                                      uint32_t value_version = 0)
+{
+    auto word = [](const DumpField& field) {
+        return static_cast<uint64_t>(field_kind(field.code)) | static_cast<uint64_t>(field.size) << 8;
+    };
+    uint64_t h = hash_step(0, key.size());
+    for (const DumpField& field : key)
+    {
+        h = hash_step(h, word(field));
+    }
+    h = hash_step(h, word(value));
+    // Opaque fields are not converted, their dumps are only portable between hosts of the same byte order
+    const bool opaque = value.code == 0 || std::ranges::any_of(key, [](const DumpField& field) { return field.code == 0; });
+    if (std::endian::native == std::endian::big && opaque)
+    {
+        h = hash_step(h, 'B');
+    }
+    return hash_mix(hash_step(h, key_version | static_cast<uint64_t>(value_version) << 32));
+}
+
+/// @brief Fields of a key, keys providing get_vals are described by their components
+template <typename Key>
+constexpr auto key_fields()
+{
+    if constexpr (requires { Key{}.get_vals(); })
+    {
+        using Values = std::remove_cvref_t<decltype(Key{}.get_vals())>;
+        return []<size_t... I>(std::index_sequence<I...>) {
+            return std::array<DumpField, sizeof...(I)>{
+                DumpField{field_code<std::tuple_element_t<I, Values>>(), bin_size_v<std::tuple_element_t<I, Values>>}...};
+        }(std::make_index_sequence<std::tuple_size_v<Values>>{});
+    }
+    else
+    {
+        return std::array{DumpField{0, Key::BinSize}};
+    }
+}
+
+/// @brief Field of a value
+template <typename Value>
+constexpr auto value_fields()
+{
+    return std::array{DumpField{field_code<Value>(), bin_size_v<Value>}};
+}
+
+/// @brief Fields of a (key, value) record
+template <typename Key, typename Value>
+constexpr auto record_fields()
+{
+    const auto key = key_fields<Key>();
+    std::array<DumpField, key.size() + 1> fields{};
+    std::ranges::copy(key, fields.begin());
+    fields.back() = value_fields<Value>()[0];
+    return fields;
+}
+
+/// @brief Fingerprint of the key type a key is derived from, 0 for keys not wrapping another
+/// Keys dumped as a digest of another key (e.g. Fingerprint) name it by a WrappedKey typedef,
+/// so that digests of different key types do not share dumps
+template <typename Key>
+constexpr uint64_t wrapped_key_fingerprint()
+{
+    if constexpr (requires { typename Key::WrappedKey; })
+    {
+        using Wrapped = typename Key::WrappedKey;
+        const uint64_t h = layout_fingerprint(key_fields<Wrapped>(), DumpField{}, schema_version<Wrapped>);
+        return hash_mix(hash_step(h, wrapped_key_fingerprint<Wrapped>()));
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+/// Structural fingerprint of Key and Value stored in and checked against dump headers
+template <typename Key, typename Value>
+inline constexpr uint64_t type_fingerprint = [] {
+    const uint64_t h =
+        layout_fingerprint(key_fields<Key>(), value_fields<Value>()[0], schema_version<Key>, schema_version<Value>);
+    constexpr uint64_t wrapped = wrapped_key_fingerprint<Key>();
+    return wrapped == 0 ? h : hash_mix(hash_step(h, wrapped));
+}();
+
+namespace detail {
+
+template <typename T>
+void swap_column(std::byte* first, size_t stride, size_t count)
+{
+    for (size_t r = 0; r < count; r++, first += stride)
+    {
+        T word;
+        std::memcpy(&word, first, sizeof(word));
+        if constexpr (sizeof(T) == 2) word = __builtin_bswap16(word);
+        else if constexpr (sizeof(T) == 4) word = __builtin_bswap32(word);
+        else word = __builtin_bswap64(word);
+        std::memcpy(first, &word, sizeof(word));
+    }
+}
+
+}  // namespace detail
+
+/// @brief Reverses bytes of arithmetic fields of consecutive records in place
+/// Each field column is converted by its own strided pass, a uniform loop the compiler vectorizes
+/// @param rows whole records
+/// @param fields fields of one record
+constexpr void swap_byte_order(std::span<std::byte> rows, std::span<const DumpField> fields)
+{
+    size_t record_size = 0;
+    for (const DumpField& field : fields)
+    {
+        record_size += field.size;
+    }
+    if (record_size == 0)
+    {
+        return;
+    }
+    const size_t records = rows.size() / record_size;
+    size_t offset = 0;
+    for (const DumpField& field : fields)
+    {
+        std::byte* first = rows.data() + offset;
+        offset += field.size;
+        if (field.code == 0 || field.size == 1)
+        {
+            continue;
+        }
+        if (!std::is_constant_evaluated())
+        {
+            switch (field.size)
+            {
+            case 2: detail::swap_column<uint16_t>(first, record_size, records); continue;
+            case 4: detail::swap_column<uint32_t>(first, record_size, records); continue;
+            case 8: detail::swap_column<uint64_t>(first, record_size, records); continue;
+            default: break;
+            }
+        }
+        for (size_t r = 0; r < records; r++)
+        {
+            std::reverse(first + r * record_size, first + r * record_size + field.size);
+        }
+    }
+}
+
+/// @brief Converts records between host and dump byte order, compiled out on little-endian hosts
+constexpr void dump_byte_order(std::span<std::byte> rows, std::span<const DumpField> fields)
+{
+    if constexpr (std::endian::native == std::endian::big)
+    {
+        swap_byte_order(rows, fields);
+    }
+}
+
+/// @brief Bytes taken by fields
+constexpr size_t fields_size(std::span<const DumpField> fields)
+{
+    size_t size = 0;
+    for (const DumpField& field : fields)
+    {
+        size += field.size;
+    }
+    return size;
+}
+
+/// @brief Bytes of a fixed file structure as stored, arithmetic fields little-endian
+/// @tparam T structure without padding describing its members in declaration order by T::fields
+template <typename T>
+std::array<std::byte, sizeof(T)> encode_fields(const T& value)
+{
+    static_assert(fields_size(T::fields) == sizeof(T), "fields must cover the structure without padding");
+    std::array<std::byte, sizeof(T)> bytes;
+    std::memcpy(bytes.data(), &value, sizeof(T));
+    dump_byte_order(bytes, T::fields);
+    return bytes;
+}
+
+/// @brief Reads a fixed file structure stored by encode_fields
+template <typename T>
+T decode_fields(std::span<const std::byte, sizeof(T)> bytes)
+{
+    std::array<std::byte, sizeof(T)> host;
+    std::ranges::copy(bytes, host.begin());
+    dump_byte_order(host, T::fields);
+    T value;
+    std::memcpy(&value, host.data(), sizeof(T));
+    return value;
+}
+
+/// @brief Field name of a layout string, a type code or "bytes<size>"
+inline std::string field_name(const DumpField& field)
+{
+    return field.code ? std::string{field.code} : "bytes" + std::to_string(field.size);
+}
+
+/// @brief Layout string of Key and Value records, e.g. "i,d:f"
+template <typename Key, typename Value>
+std::string dump_layout()
+{
+    std::string res;
+    for (const DumpField& field : key_fields<Key>())
+    {
+        res += (res.empty() ? "" : ",") + field_name(field);
+    }
+    return res + ":" + field_name(value_fields<Value>()[0]);
+}
+
+/// @brief Builds name of an associated dump file from the type fingerprint, stable across builds
+/// @tparam Key type of a key
+/// @tparam Value type of cached values
+/// @tparam Tag file tag string for identificaion
+/// @param kind optional suffix distinguishing dump formats of the same types
+/// @return name of an associated file
+template <typename Key, typename Value, StringLiteral Tag>
+std::string cache_file_name(std::string_view kind = "")
+{
+    char fingerprint[17];
+    std::snprintf(fingerprint, sizeof(fingerprint), "%016llx",
+                  static_cast<unsigned long long>(type_fingerprint<Key, Value>));
+    std::string res = "_cache_";
+    res += fingerprint;
+    if constexpr (std::string_view{Tag.value} != "")
+    {
+        res += "_" + std::string{Tag.value};
+    }
+    if (!kind.empty())
+    {
+        res += "_";
+        res += kind;
+    }
+    res += ".bin";
+    return res;
+}
+
+inline constexpr std::array<char, 4> DumpMagic = {'C', 'D', 'M', 'P'};
+inline constexpr uint32_t DumpVersion = 1;
+/// DumpHeader flag: record payload is followed by AccessStats of every record
+inline constexpr uint32_t DumpAccessStats = 1;
+
+/// Fixed-size start of a dump file, followed by layout_size layout bytes and payload_size payload bytes
+struct DumpHeader
+{
+    std::array<char, 4> magic = DumpMagic;
+    uint32_t version = DumpVersion;
+    uint64_t fingerprint = 0;
+    uint64_t count = 0;  // entries
+    uint64_t payload_size = 0;
+    uint64_t checksum = 0;  // DumpChecksum of payload
+    uint32_t key_size = 0;
+    uint32_t value_size = 0;
+    uint32_t layout_size = 0;
+    uint32_t flags = 0;
+
+    /// Members in declaration order, magic is kept as bytes
+    static constexpr std::array<DumpField, 10> fields = {
+        DumpField{0, 4},   DumpField{'j', 4}, DumpField{'y', 8}, DumpField{'y', 8}, DumpField{'y', 8},
+        DumpField{'y', 8}, DumpField{'j', 4}, DumpField{'j', 4}, DumpField{'j', 4}, DumpField{'j', 4}};
+
+    /// @brief Checks that a header read from a file describes the same format and types
+    [[nodiscard]] bool matches(const DumpHeader& expected) const
+    {
+        return magic == DumpMagic && version == DumpVersion && fingerprint == expected.fingerprint
+            && key_size == expected.key_size && value_size == expected.value_size;
+    }
+};
+
+/// @brief Header of a dump of Key and Value records
+template <typename Key, typename Value>
+DumpHeader make_dump_header(uint64_t fingerprint = type_fingerprint<Key, Value>)
+{
+    DumpHeader header;
+    header.fingerprint = fingerprint;
+    header.key_size = static_cast<uint32_t>(Key::BinSize);
+    header.value_size = static_cast<uint32_t>(bin_size_v<Value>);
+    return header;
+}
+
+/// Access counters of a cache entry persisted with its record
+struct AccessStats
+{
+    /// Accesses of the entry, saturating
+    uint32_t frequency = 0;
+    /// Accesses of the cache (or eviction sweeps) since the last access of the entry
+    uint32_t idle = 0;
+
+    /// @brief Ranking of entries to keep, recent and frequent ones first
+    [[nodiscard]] double hotness() const
+    {
+        return (frequency + 1.0) / (idle + 1.0);
+    }
+};
+
+/**
+ * LoadBudget struct
+ *
+ * Limits of restoring a dump, entries are restored hottest first when the dump carries
+ * AccessStats and the rest is dropped once a limit is reached
+ */
+struct LoadBudget
+{
+    size_t max_entries = SIZE_MAX;
+    /// Compared to entries times bytes per entry estimated by the cache
+    size_t max_bytes = SIZE_MAX;
+    std::chrono::steady_clock::duration max_duration = std::chrono::steady_clock::duration::max();
+
+    /// @brief Number of entries to restore under entry and memory limits
+    [[nodiscard]] size_t entries(size_t count, size_t entry_size) const
+    {
+        return std::min({count, max_entries, max_bytes / std::max<size_t>(entry_size, 1)});
+    }
+};
+
+/// Incremental checksum of dump payloads, independent of how writes are split
+/// Little-endian 64-bit words are hashed, whole words are loaded at once outside a word left
+/// incomplete by a previous update
+class DumpChecksum
+{
+public:
+    void update(std::span<const std::byte> bytes)
+    {
+        size_t offset = 0;
+        for (; offset < bytes.size() && size % 8 != 0; offset++)
+        {
+            push(bytes[offset]);
+        }
+        for (; offset + 8 <= bytes.size(); offset += 8)
+        {
+            uint64_t word = 0;
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                std::memcpy(&word, bytes.data() + offset, sizeof(word));
+            }
+            else
+            {
+                for (size_t i = 0; i < 8; i++)
+                {
+                    word |= static_cast<uint64_t>(bytes[offset + i]) << (8 * i);
+                }
+            }
+            h = hash_step(h, word);
+            size += 8;
+        }
+        for (; offset < bytes.size(); offset++)
+        {
+            push(bytes[offset]);
+        }
+    }
+
+    [[nodiscard]] uint64_t value() const
+    {
+        return hash_mix((size % 8 ? hash_step(h, pending) : h) ^ size);
+    }
+
+private:
+    void push(std::byte byte)
+    {
+        pending |= static_cast<uint64_t>(byte) << (8 * (size++ % 8));
+        if (size % 8 == 0)
+        {
+            h = hash_step(h, pending);
+            pending = 0;
+        }
+    }
+
+    uint64_t h = 0;
+    uint64_t pending = 0;
+    uint64_t size = 0;
+};
+
+/**
+ * DumpStore class
+ *
+ * Single file holding dumps of many caches as namespaces keyed by dump name (type fingerprint,
+ * Tag and kind) instead of a file per cache. While a store lives, every cache reads and writes
+ * its dump through it: namespaces are read lazily and independently when a cache is constructed,
+ * dumps of destroyed caches are kept in memory and the whole store is rewritten with a single
+ * sequential stream by flush or destruction, namespaces not dumped again are copied unchanged
+ * Caches using a store must be destroyed before it, typically by declaring the store first
+ */
+class DumpStore
+{
+public:
+    /// @param path store file, created by the first flush
+    explicit DumpStore(std::string path) : path{std::move(path)}, previous{current.exchange(this)}
+    {
+        read_directory();
+    }
+
+    DumpStore(const DumpStore&) = delete;
+    DumpStore& operator=(const DumpStore&) = delete;
+
+    ~DumpStore()
+    {
+        flush();
+        current = previous;
+    }
+
+    /// Store file starts with StoreHeader and directory of DirectoryEntry records, dump images of
+    /// namespaces follow at offsets given by the directory
+    struct StoreHeader
+    {
+        std::array<char, 4> magic = {'C', 'S', 'T', 'R'};
+        uint32_t version = DumpVersion;
+        uint32_t namespaces = 0;
+        uint32_t reserved = 0;
+
+        static constexpr std::array<DumpField, 4> fields = {DumpField{0, 4}, DumpField{'j', 4}, DumpField{'j', 4},
+                                                            DumpField{'j', 4}};
+    };
+
+    /// Directory record followed by name_size bytes of name
+    struct DirectoryEntry
+    {
+        uint64_t fingerprint = 0;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t name_size = 0;
+        uint32_t reserved = 0;
+
+        static constexpr std::array<DumpField, 5> fields = {DumpField{'y', 8}, DumpField{'y', 8}, DumpField{'y', 8},
+                                                            DumpField{'j', 4}, DumpField{'j', 4}};
+    };
+
+    /// @brief Store receiving dumps of caches, nullptr when caches use their own files
+    static DumpStore* active()
+    {
+        return current.load();
+    }
+
+    /// @brief Reads dump image of a namespace
+    /// @param name dump name of a cache
+    /// @param fingerprint expected fingerprint, other namespaces are rejected without reading
+    /// @return dump image or std::nullopt for a missing namespace
+    std::optional<std::vector<std::byte>> read(const std::string& name, uint64_t fingerprint) const
+    {
+        std::lock_guard lk{mtx};
+        const auto it = entries.find(name);
+        if (it == entries.end() || it->second.fingerprint != fingerprint)
+        {
+            return std::nullopt;
+        }
+        if (it->second.pending)
+        {
+            return it->second.image;
+        }
+        std::vector<std::byte> image(it->second.size);
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(it->second.offset));
+        if (!file.read(reinterpret_cast<char*>(image.data()), static_cast<std::streamsize>(image.size())))
+        {
+            return std::nullopt;
+        }
+        return image;
+    }
+
+    /// @brief Replaces dump image of a namespace, written to the file by the next flush
+    void write(const std::string& name, uint64_t fingerprint, std::vector<std::byte> image)
+    {
+        std::lock_guard lk{mtx};
+        Entry& entry = entries[name];
+        entry.fingerprint = fingerprint;
+        entry.size = image.size();
+        entry.image = std::move(image);
+        entry.pending = true;
+    }
+
+    /// @brief Writes the store with all namespaces if any was replaced
+    /// The new file is written next to the old one and renamed over it
+    /// @return whether the store file is up to date
+    bool flush()
+    {
+        std::lock_guard lk{mtx};
+        if (std::ranges::none_of(entries, [](const auto& entry) { return entry.second.pending; }))
+        {
+            return true;
+        }
+
+        StoreHeader header;
+        header.namespaces = static_cast<uint32_t>(entries.size());
+        uint64_t offset = sizeof(header);
+        for (const auto& [name, entry] : entries)
+        {
+            offset += sizeof(DirectoryEntry) + name.size();
+        }
+        std::map<std::string, uint64_t> offsets;
+        for (const auto& [name, entry] : entries)
+        {
+            offsets[name] = offset;
+            offset += entry.size;
+        }
+
+        const std::string temp = path + ".tmp";
+        std::ofstream out{temp, std::ios::binary};
+        put(out, encode_fields(header));
+        for (const auto& [name, entry] : entries)
+        {
+            const DirectoryEntry record{entry.fingerprint, offsets[name], entry.size, static_cast<uint32_t>(name.size())};
+            put(out, encode_fields(record));
+            out.write(name.data(), static_cast<std::streamsize>(name.size()));
+        }
+        std::vector<char> chunk(1 << 20);
+        for (const auto& [name, entry] : entries)
+        {
+            if (entry.pending)
+            {
+                out.write(reinterpret_cast<const char*>(entry.image.data()), static_cast<std::streamsize>(entry.size));
+                continue;
+            }
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(entry.offset));
+            for (uint64_t left = entry.size; left > 0 && out;)
+            {
+                const auto part = static_cast<std::streamsize>(std::min<uint64_t>(left, chunk.size()));
+                if (!file.read(chunk.data(), part))
+                {
+                    out.setstate(std::ios::failbit);
+                    break;
+                }
+                out.write(chunk.data(), part);
+                left -= static_cast<uint64_t>(part);
+            }
+        }
+        out.close();
+        file.close();
+        if (!out || std::rename(temp.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temp.c_str());
+            file.open(path, std::ios::binary);
+            return false;
+        }
+
+        file.open(path, std::ios::binary);
+        for (auto& [name, entry] : entries)
+        {
+            entry.offset = offsets[name];
+            entry.pending = false;
+            entry.image = {};
+        }
+        return true;
+    }
+
+    /// @brief Names of namespaces in the store
+    std::vector<std::string> namespaces() const
+    {
+        std::lock_guard lk{mtx};
+        std::vector<std::string> names;
+        for (const auto& [name, entry] : entries)
+        {
+            names.push_back(name);
+        }
+        return names;
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t fingerprint = 0;
+        uint64_t offset = 0;  // in the store file unless pending
+        uint64_t size = 0;
+        std::vector<std::byte> image;
+        bool pending = false;
+    };
+
+    /// @brief Reads directory of an existing store, an unreadable store is replaced on flush
+    void read_directory()
+    {
+        file.open(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            return;
+        }
+        const auto file_size = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+        const auto header = get<StoreHeader>(file);
+        if (!header || header->magic != StoreHeader{}.magic || header->version != DumpVersion)
+        {
+            return;
+        }
+        for (uint32_t i = 0; i < header->namespaces; i++)
+        {
+            const auto record = get<DirectoryEntry>(file);
+            std::string name;
+            if (!record || record->offset + record->size > file_size)
+            {
+                entries.clear();
+                return;
+            }
+            name.resize(record->name_size);
+            if (!file.read(name.data(), record->name_size))
+            {
+                entries.clear();
+                return;
+            }
+            entries[name] = {record->fingerprint, record->offset, record->size, {}, false};
+        }
+    }
+
+    template <size_t N>
+    static void put(std::ofstream& out, const std::array<std::byte, N>& bytes)
+    {
+        out.write(reinterpret_cast<const char*>(bytes.data()), N);
+    }
+
+    template <typename T>
+    static std::optional<T> get(std::ifstream& in)
+    {
+        std::array<std::byte, sizeof(T)> bytes;
+        if (!in.read(reinterpret_cast<char*>(bytes.data()), sizeof(T)))
+        {
+            return std::nullopt;
+        }
+        return decode_fields<T>(bytes);
+    }
+
+    static inline std::atomic<DumpStore*> current = nullptr;
+
+    const std::string path;
+    DumpStore* const previous;
+    mutable std::mutex mtx;
+    mutable std::ifstream file;
+    std::map<std::string, Entry> entries;
+};
+
+/**
+ * DumpWriter class
+ *
+ * Streams payload of a dump, the header is completed with count and checksum by finish
+ * Writes into the active DumpStore if there is one
+ */
+class DumpWriter
+{
+public:
+    /// @param file_name dump file to replace
+    /// @param header header with fingerprint and sizes, counts are filled in by finish
+    /// @param layout layout string stored after the header
+    DumpWriter(const std::string& file_name, const DumpHeader& header, std::string_view layout)
+        : name{file_name}, store{DumpStore::active()}, header{header}
+    {
+        if (!store)
+        {
+            file.open(file_name, std::ios::binary);
+        }
+        this->header.layout_size = static_cast<uint32_t>(layout.size());
+        write_header();
+        put(std::as_bytes(std::span{layout}));
+    }
+
+    void write(std::span<const std::byte> bytes)
+    {
+        put(bytes);
+        checksum.update(bytes);
+        header.payload_size += bytes.size();
+    }
+
+    /// @brief Writes serialized records converting them to dump byte order in place
+    void write_rows(std::span<std::byte> rows, std::span<const DumpField> fields)
+    {
+        dump_byte_order(rows, fields);
+        write(rows);
+    }
+
+    /// @brief Appends access counters of every written record after the records
+    void write_access_stats(std::span<AccessStats> stats)
+    {
+        header.flags |= DumpAccessStats;
+        write_rows(std::as_writable_bytes(stats), value_fields<uint32_t>());
+    }
+
+    /// @brief Completes header, a dump not finished is rejected on load
+    /// @param count number of entries written
+    /// @return whether the whole file was written
+    bool finish(size_t count)
+    {
+        header.count = count;
+        header.checksum = checksum.value();
+        if (store)
+        {
+            std::ranges::copy(encode_fields(header), image.begin());
+            store->write(name, header.fingerprint, std::move(image));
+            return true;
+        }
+        file.seekp(0);
+        write_header();
+        file.flush();
+        return file.good();
+    }
+
+private:
+    void put(std::span<const std::byte> bytes)
+    {
+        if (store)
+        {
+            image.insert(image.end(), bytes.begin(), bytes.end());
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    void write_header()
+    {
+        put(encode_fields(header));
+    }
+
+    const std::string name;
+    DumpStore* const store;
+    std::ofstream file;
+    std::vector<std::byte> image;
+    DumpHeader header;
+    DumpChecksum checksum;
+};
+
+/// Payload of a dump accepted by read_dump
+struct DumpPayload
+{
+    size_t count = 0;
+    std::vector<std::byte> bytes;
+    uint32_t flags = 0;
+    /// Access counters per record, filled by read_records for dumps carrying them
+    std::vector<AccessStats> stats;
+
+    /// @brief Record indices hottest first, file order for dumps without access counters
+    [[nodiscard]] std::vector<size_t> hotness_order() const
+    {
+        std::vector<size_t> order(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            order[i] = i;
+        }
+        if (!stats.empty())
+        {
+            std::ranges::stable_sort(order, std::ranges::greater{}, [&](size_t i) { return stats[i].hotness(); });
+        }
+        return order;
+    }
+};
+
+/// @brief Checks header of a dump image and extracts its payload
+inline std::optional<DumpPayload> parse_dump(std::span<const std::byte> image, const DumpHeader& expected)
+{
+    if (image.size() < sizeof(DumpHeader))
+    {
+        return std::nullopt;
+    }
+    const auto header = decode_fields<DumpHeader>(image.first<sizeof(DumpHeader)>());
+    if (!header.matches(expected) || image.size() != sizeof(header) + header.layout_size + header.payload_size)
+    {
+        return std::nullopt;
+    }
+    const auto payload = image.subspan(sizeof(header) + header.layout_size);
+    DumpChecksum checksum;
+    checksum.update(payload);
+    if (checksum.value() != header.checksum)
+    {
+        return std::nullopt;
+    }
+    return DumpPayload{header.count, {payload.begin(), payload.end()}, header.flags, {}};
+}
+
+/// @brief Reads payload of a dump written for the expected format
+/// A missing file, a header of other types or version and a truncated file are rejected
+/// before the payload is read, a corrupted payload by its checksum
+/// Dumps are read from the active DumpStore if there is one
+/// @param file_name dump file
+/// @param expected header built for the reading types
+/// @return payload or std::nullopt for a missing or rejected file
+inline std::optional<DumpPayload> read_dump(const std::string& file_name, const DumpHeader& expected)
+{
+    if (const DumpStore* store = DumpStore::active())
+    {
+        const auto image = store->read(file_name, expected.fingerprint);
+        return image ? parse_dump(*image, expected) : std::nullopt;
+    }
+
+    std::ifstream file{file_name, std::ios::binary | std::ios::ate};
+    if (!file.good())
+    {
+        return std::nullopt;
+    }
+    const auto file_size = static_cast<uint64_t>(file.tellg());
+    std::array<std::byte, sizeof(DumpHeader)> header_bytes;
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(header_bytes.data()), sizeof(header_bytes)))
+    {
+        return std::nullopt;
+    }
+    const auto header = decode_fields<DumpHeader>(header_bytes);
+    if (!header.matches(expected) || file_size != sizeof(header) + header.layout_size + header.payload_size)
+    {
+        return std::nullopt;
+    }
+
+    DumpPayload payload{header.count, std::vector<std::byte>(header.payload_size), header.flags, {}};
+    file.seekg(sizeof(header) + header.layout_size);
+    if (!file.read(reinterpret_cast<char*>(payload.bytes.data()), static_cast<std::streamsize>(payload.bytes.size())))
+    {
+        return std::nullopt;
+    }
+    DumpChecksum checksum;
+    checksum.update(payload.bytes);
+    if (checksum.value() != header.checksum)
+    {
+        return std::nullopt;
+    }
+    return payload;
+}
+
+/// @brief Reads payload of (key, value) records written by write_records in host byte order
+/// Access counters following the records are moved to stats
+template <typename Key, typename Value>
+std::optional<DumpPayload> read_records(const std::string& file_name)
+{
+    auto payload = read_dump(file_name, make_dump_header<Key, Value>());
+    if (!payload)
+    {
+        return std::nullopt;
+    }
+    const size_t records_size = payload->count * (Key::BinSize + bin_size_v<Value>);
+    const size_t stats_size = payload->flags & DumpAccessStats ? payload->count * sizeof(AccessStats) : 0;
+    if (payload->bytes.size() != records_size + stats_size)
+    {
+        return std::nullopt;
+    }
+    if (stats_size != 0)
+    {
+        payload->stats.resize(payload->count);
+        std::memcpy(payload->stats.data(), payload->bytes.data() + records_size, stats_size);
+        dump_byte_order(std::as_writable_bytes(std::span{payload->stats}), value_fields<uint32_t>());
+        payload->bytes.resize(records_size);
+    }
+    dump_byte_order(payload->bytes, record_fields<Key, Value>());
+    return payload;
+}
+
+/// @brief Opens writer of (key, value) records
+template <typename Key, typename Value>
+DumpWriter write_records(const std::string& file_name)
+{
+    return DumpWriter{file_name, make_dump_header<Key, Value>(), dump_layout<Key, Value>()};
+}
+
+}  // namespace Caching
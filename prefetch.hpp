@@ -0,0 +1,145 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace Caching {
+
+/// @brief Hints CPU to bring cache line containing address into all cache levels
+inline void prefetch_address(const void* address)
+{
+    __builtin_prefetch(address, 0, 3);
+}
+
+/**
+ * StridePredictor class
+ *
+ * Detects constant strides between consecutively accessed keys
+ * Keys providing get_vals with arithmetic components are supported: when the component-wise
+ * difference between the last accesses repeats, keys further along the stride are predicted
+ *
+ * @tparam Key type of a key
+ */
+template <typename Key>
+class StridePredictor
+{
+    static auto values_type()
+    {
+        if constexpr (requires { Key{}.get_vals(); })
+        {
+            return std::remove_cvref_t<decltype(Key{}.get_vals())>{};
+        }
+        else
+        {
+            return std::tuple<>{};
+        }
+    }
+
+    using Values = decltype(values_type());
+
+    template <typename T>
+    static constexpr bool strideable_v = std::is_arithmetic_v<T> && !std::same_as<T, bool>;
+
+    static constexpr bool supported = [] {
+        if constexpr (requires { Key{}.get_vals(); })
+        {
+            return std::apply([](auto&&... args) { return (strideable_v<std::remove_cvref_t<decltype(args)>> && ...); },
+                              Key{}.get_vals());
+        }
+        return false;
+    }();
+
+public:
+    /// Number of stride repetitions required before predicting
+    static constexpr size_t RequiredConfidence = 2;
+
+    /// @brief Records accessed key
+    /// @return whether a stable stride is detected
+    bool observe(const Key& key)
+    {
+        if constexpr (supported)
+        {
+            const auto& vals = key.get_vals();
+            if (last)
+            {
+                auto delta = difference(vals, *last);
+                if (delta == stride && delta != decltype(delta){})
+                {
+                    confidence++;
+                }
+                else
+                {
+                    stride = delta;
+                    confidence = 0;
+                }
+            }
+            last = vals;
+            return confidence >= RequiredConfidence;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    /// @brief Key expected given number of accesses after the last observed one
+    [[nodiscard]] Key predict(size_t ahead) const
+    {
+        if constexpr (supported)
+        {
+            return predict_impl(ahead, std::make_index_sequence<std::tuple_size_v<Values>>{});
+        }
+        else
+        {
+            return Key{};
+        }
+    }
+
+private:
+    /// Integral components are computed in unsigned arithmetic at least as wide as unsigned int,
+    /// so strides between extreme keys wrap instead of overflowing
+    template <typename T>
+    using Wrapping = std::conditional_t<std::is_integral_v<T>,
+                                        std::common_type_t<std::make_unsigned_t<std::conditional_t<std::is_integral_v<T>, T, int>>, unsigned>,
+                                        T>;
+
+    template <typename T>
+    static T subtract(T lhs, T rhs)
+    {
+        return static_cast<T>(static_cast<Wrapping<T>>(lhs) - static_cast<Wrapping<T>>(rhs));
+    }
+
+    template <typename T>
+    static T advance(T from, T stride, size_t ahead)
+    {
+        return static_cast<T>(static_cast<Wrapping<T>>(from)
+                              + static_cast<Wrapping<T>>(stride) * static_cast<Wrapping<T>>(ahead));
+    }
+
+    template <size_t... I>
+    static Values difference(const Values& lhs, const Values& rhs, std::index_sequence<I...>)
+    {
+        return Values{subtract(std::get<I>(lhs), std::get<I>(rhs))...};
+    }
+
+    static Values difference(const Values& lhs, const Values& rhs)
+    {
+        return difference(lhs, rhs, std::make_index_sequence<std::tuple_size_v<Values>>{});
+    }
+
+    template <size_t... I>
+    Key predict_impl(size_t ahead, std::index_sequence<I...>) const
+    {
+        return Key{advance(std::get<I>(*last), std::get<I>(stride), ahead)...};
+    }
+
+    std::optional<Values> last;
+    Values stride{};
+    size_t confidence = 0;
+};
+
+}  // namespace Caching
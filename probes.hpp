@@ -0,0 +1,65 @@
+#pragma once
+
+/**
+ * USDT static tracepoints
+ *
+ * Defining CACHING_USDT (CMake option CACHING_USDT) places sys/sdt.h probes of provider "caching"
+ * on hot paths. Every probe has a semaphore which tracers increment while attached, arguments
+ * are evaluated only when CACHING_PROBE_ENABLED(name) sees it set, so an idle probe costs a load
+ * and a not taken branch. Without CACHING_USDT the macro expands to nothing and
+ * CACHING_PROBE_ENABLED to false
+ * Semaphores are enabled for the whole translation unit, other sys/sdt.h users in it have to
+ * define semaphores of their probes as well
+ *
+ * Probes and arguments (tag is a C string of cache Tag):
+ *  load_begin(tag, key_hash)           load_hit(tag, key_hash, value_size)   load_miss(tag, key_hash)
+ *  store(tag, key_hash, value_size)    evict(tag, slot)
+ *  lock_wait_begin(tag, exclusive)     lock_wait_end(tag, exclusive)
+ *  dump_begin(tag, entries)            dump_end(tag, bytes)
+ *  file_load_begin(tag)                file_load_end(tag, entries, bytes)
+ *
+ * Example bpftrace scripts are in tools/bpftrace
+ */
+
+#if defined(CACHING_USDT) && __has_include(<sys/sdt.h>)
+#ifndef _SDT_HAS_SEMAPHORES
+#define _SDT_HAS_SEMAPHORES 1
+#endif
+#include <sys/sdt.h>
+
+// Weak definitions let every translation unit including the header define them once per binary
+#define CACHING_PROBE_SEMAPHORE(name) \
+    __attribute__((weak, section(".probes"))) volatile unsigned short caching_##name##_semaphore = 0;
+
+extern "C" {
+CACHING_PROBE_SEMAPHORE(load_begin)
+CACHING_PROBE_SEMAPHORE(load_hit)
+CACHING_PROBE_SEMAPHORE(load_miss)
+CACHING_PROBE_SEMAPHORE(store)
+CACHING_PROBE_SEMAPHORE(evict)
+CACHING_PROBE_SEMAPHORE(lock_wait_begin)
+CACHING_PROBE_SEMAPHORE(lock_wait_end)
+CACHING_PROBE_SEMAPHORE(dump_begin)
+CACHING_PROBE_SEMAPHORE(dump_end)
+CACHING_PROBE_SEMAPHORE(file_load_begin)
+CACHING_PROBE_SEMAPHORE(file_load_end)
+}
+
+#undef CACHING_PROBE_SEMAPHORE
+
+#define CACHING_PROBE_ENABLED(name) __builtin_expect(caching_##name##_semaphore != 0, 0)
+#define CACHING_PROBE(name, ...)                        \
+    do                                                  \
+    {                                                   \
+        if (CACHING_PROBE_ENABLED(name))                \
+        {                                               \
+            STAP_PROBEV(caching, name, __VA_ARGS__);    \
+        }                                               \
+    } while (0)
+#else
+#if defined(CACHING_USDT)
+#pragma message("CACHING_USDT is defined but <sys/sdt.h> is unavailable, USDT probes are disabled")
+#endif
+#define CACHING_PROBE_ENABLED(name) false
+#define CACHING_PROBE(name, ...) static_cast<void>(0)
+#endif
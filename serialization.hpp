@@ -1,17 +1,406 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
 namespace Caching {
 
+namespace detail {
+
+template <typename T>
+inline constexpr bool is_std_array = false;
+
+template <typename E, size_t N>
+inline constexpr bool is_std_array<std::array<E, N>> = true;
+
+/// Converts to any field type, counts fields of an aggregate by brace initialization
+struct any_field
+{
+    template <typename T>
+    constexpr operator T() const;
+};
+
+template <typename T, typename... Fields>
+constexpr size_t count_fields()
+{
+    if constexpr (requires { T{Fields{}..., any_field{}}; })
+    {
+        return count_fields<T, Fields..., any_field>();
+    }
+    else
+    {
+        return sizeof...(Fields);
+    }
+}
+
+}  // namespace detail
+
+/// @brief Aggregate serialized field by field without padding bytes
+/// Classes providing serialize, tuple-like types such as std::array and aggregates with C array
+/// members are excluded, the latter because brace elision makes their fields uncountable
+template <typename T>
+concept packed_aggregate = std::is_class_v<T> && std::is_aggregate_v<T> && !requires(const T& val) { val.serialize(); }
+                        && !requires { std::tuple_size<T>::value; } && detail::count_fields<T>() > 0
+                        && detail::count_fields<T>() <= 16;
+
+/// @brief References to fields of an aggregate in declaration order
+template <packed_aggregate T>
+constexpr auto tie_fields(T& value)
+{
+    constexpr size_t N = detail::count_fields<T>();
+    if constexpr (N == 1)
+    {
+        auto& [f0] = value;
+        return std::tie(f0);
+    }
+    else if constexpr (N == 2)
+    {
+        auto& [f0, f1] = value;
+        return std::tie(f0, f1);
+    }
+    else if constexpr (N == 3)
+    {
+        auto& [f0, f1, f2] = value;
+        return std::tie(f0, f1, f2);
+    }
+    else if constexpr (N == 4)
+    {
+        auto& [f0, f1, f2, f3] = value;
+        return std::tie(f0, f1, f2, f3);
+    }
+    else if constexpr (N == 5)
+    {
+        auto& [f0, f1, f2, f3, f4] = value;
+        return std::tie(f0, f1, f2, f3, f4);
+    }
+    else if constexpr (N == 6)
+    {
+        auto& [f0, f1, f2, f3, f4, f5] = value;
+        return std::tie(f0, f1, f2, f3, f4, f5);
+    }
+    else if constexpr (N == 7)
+    {
+        auto& [f0, f1, f2, f3, f4, f5, f6] = value;
+        return std::tie(f0, f1, f2, f3, f4, f5, f6);
+    }
+    else if constexpr (N == 8)
+    {
+        auto& [f0, f1, f2, f3, f4, f5, f6, f7] = value;
+        return std::tie(f0, f1, f2, f3, f4, f5, f6, f7);
+    }
+    else if constexpr (N == 9)
+    {
+        auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8] = value;
+        return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8);
+    }
+    else if constexpr (N == 10)
+    {
+        auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = value;
+        return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9);
+    }
+    else if constexpr (N == 11)
+    {
+        auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = value;
+        return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10);
+    }
+    else if constexpr (N == 12)
+    {
+        auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = value;
+        return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11);
+    }
+    else if constexpr (N == 13)
+    {
+        auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12] = value;
+        return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12);
+    }
+    else if constexpr (N == 14)
+    {
+        auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13] = value;
+        return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13);
+    }
+    else if constexpr (N == 15)
+    {
+        auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14] = value;
+        return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14);
+    }
+    else if constexpr (N == 16)
+    {
+        auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15] = value;
+        return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15);
+    }
+}
+
+/// @brief Size of serialized representation: BinSize of classes providing it, sum of field sizes
+/// of packed aggregates and std::array elements, object size of other trivially copyable types
+template <typename T>
+constexpr size_t bin_size()
+{
+    if constexpr (requires { T::BinSize; })
+    {
+        return T::BinSize;
+    }
+    else if constexpr (detail::is_std_array<T>)
+    {
+        return std::tuple_size_v<T> * bin_size<typename T::value_type>();
+    }
+    else if constexpr (packed_aggregate<T>)
+    {
+        return []<typename... F>(std::type_identity<std::tuple<F&...>>) {
+            return (bin_size<std::remove_cv_t<F>>() + ...);
+        }(std::type_identity<decltype(tie_fields(std::declval<T&>()))>{});
+    }
+    else
+    {
+        return sizeof(T);
+    }
+}
+
+template <typename T>
+inline constexpr size_t bin_size_v = bin_size<T>();
+
+/// Contiguous bytes copied between an object and its serialized representation
+struct CopyRun
+{
+    size_t object_offset = 0;
+    size_t bytes_offset = 0;
+    size_t size = 0;
+};
+
+namespace detail {
+
+template <typename T>
+using field_refs = decltype(tie_fields(std::declval<T&>()));
+
+/// @brief Object size of an aggregate with fields placed as the ABI places standard-layout members
+template <typename T>
+constexpr size_t simulated_size()
+{
+    return []<typename... F>(std::type_identity<std::tuple<F&...>>) {
+        size_t offset = 0;
+        ((offset = (offset + alignof(F) - 1) / alignof(F) * alignof(F) + sizeof(F)), ...);
+        return (offset + alignof(T) - 1) / alignof(T) * alignof(T);
+    }(std::type_identity<field_refs<T>>{});
+}
+
+/// @brief Whether serialized representation is a fixed set of copies out of object memory
+/// Aggregates qualify when standard-layout and their simulated layout matches sizeof
+template <typename T>
+constexpr bool plannable()
+{
+    if constexpr (requires(const T& val) { val.serialize(); } || !std::is_trivially_copyable_v<T>)
+    {
+        return false;
+    }
+    else if constexpr (is_std_array<T>)
+    {
+        return plannable<typename T::value_type>();
+    }
+    else if constexpr (packed_aggregate<T>)
+    {
+        return std::is_standard_layout_v<T> && simulated_size<T>() == sizeof(T)
+            && []<typename... F>(std::type_identity<std::tuple<F&...>>) {
+                   return (plannable<std::remove_cv_t<F>>() && ...);
+               }(std::type_identity<field_refs<T>>{});
+    }
+    else
+    {
+        return true;
+    }
+}
+
+template <size_t Capacity>
+struct PlanBuilder
+{
+    std::array<CopyRun, Capacity> runs{};
+    size_t count = 0;
+
+    /// @brief Appends copy, merging it into the previous one when both ranges continue it
+    constexpr void add(size_t object_offset, size_t bytes_offset, size_t size)
+    {
+        if (count > 0 && runs[count - 1].object_offset + runs[count - 1].size == object_offset
+            && runs[count - 1].bytes_offset + runs[count - 1].size == bytes_offset)
+        {
+            runs[count - 1].size += size;
+            return;
+        }
+        runs[count++] = {object_offset, bytes_offset, size};
+    }
+};
+
+/// @brief Whether a type is stored as its serialized bytes, copied by a single run
+template <typename T>
+constexpr bool dense();
+
+/// @brief Upper bound of runs in a plan
+template <typename T>
+constexpr size_t leaf_count()
+{
+    if constexpr (is_std_array<T>)
+    {
+        return dense<T>() ? 1 : std::tuple_size_v<T> * leaf_count<typename T::value_type>();
+    }
+    else if constexpr (packed_aggregate<T>)
+    {
+        return []<typename... F>(std::type_identity<std::tuple<F&...>>) {
+            return (leaf_count<std::remove_cv_t<F>>() + ...);
+        }(std::type_identity<field_refs<T>>{});
+    }
+    else
+    {
+        return 1;
+    }
+}
+
+template <typename T, typename Builder>
+constexpr void plan_into(Builder& builder, size_t object_offset, size_t bytes_offset)
+{
+    if constexpr (is_std_array<T>)
+    {
+        if constexpr (dense<T>())
+        {
+            builder.add(object_offset, bytes_offset, sizeof(T));
+            return;
+        }
+        using E = typename T::value_type;
+        for (size_t i = 0; i < std::tuple_size_v<T>; i++)
+        {
+            plan_into<E>(builder, object_offset + i * sizeof(E), bytes_offset + i * bin_size_v<E>);
+        }
+    }
+    else if constexpr (packed_aggregate<T>)
+    {
+        size_t offset = 0;
+        auto field = [&]<typename F>(std::type_identity<F>) {
+            offset = (offset + alignof(F) - 1) / alignof(F) * alignof(F);
+            plan_into<std::remove_cv_t<F>>(builder, object_offset + offset, bytes_offset);
+            offset += sizeof(F);
+            bytes_offset += bin_size_v<std::remove_cv_t<F>>;
+        };
+        [&]<typename... F>(std::type_identity<std::tuple<F&...>>) {
+            (field(std::type_identity<F>{}), ...);
+        }(std::type_identity<field_refs<T>>{});
+    }
+    else
+    {
+        builder.add(object_offset, bytes_offset, sizeof(T));
+    }
+}
+
+template <typename T>
+constexpr auto build_plan()
+{
+    PlanBuilder<leaf_count<T>()> builder;
+    plan_into<T>(builder, 0, 0);
+    return builder;
+}
+
+template <typename T>
+constexpr bool dense()
+{
+    if constexpr (is_std_array<T>)
+    {
+        return bin_size_v<T> == sizeof(T) && dense<typename T::value_type>();
+    }
+    else if constexpr (packed_aggregate<T>)
+    {
+        return bin_size_v<T> == sizeof(T) && []<typename... F>(std::type_identity<std::tuple<F&...>>) {
+            return (dense<std::remove_cv_t<F>>() && ...);
+        }(std::type_identity<field_refs<T>>{});
+    }
+    else
+    {
+        return true;
+    }
+}
+}  // namespace detail
+
+/// Copies serializing a plannable type, adjacent fields without padding between them are merged
+/// into one run, a type without padding is a single run of its whole object
+template <typename T>
+    requires(detail::plannable<T>())
+inline constexpr auto serialization_plan = [] {
+    constexpr auto builder = detail::build_plan<T>();
+    std::array<CopyRun, builder.count> runs{};
+    std::copy_n(builder.runs.begin(), builder.count, runs.begin());
+    return runs;
+}();
+
+namespace detail {
+
+/// @brief Serializes by the plan, every copy has constant size and offsets
+template <typename T>
+void copy_out(const T& val, std::byte* out)
+{
+    constexpr const auto& plan = serialization_plan<T>;
+    const auto* object = reinterpret_cast<const std::byte*>(&val);
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        (std::memcpy(out + plan[I].bytes_offset, object + plan[I].object_offset, plan[I].size), ...);
+    }(std::make_index_sequence<plan.size()>{});
+}
+
+/// @brief Deserializes by the plan into an existing object
+template <typename T>
+void copy_in(T& val, const std::byte* in)
+{
+    constexpr const auto& plan = serialization_plan<T>;
+    auto* object = reinterpret_cast<std::byte*>(&val);
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        (std::memcpy(object + plan[I].object_offset, in + plan[I].bytes_offset, plan[I].size), ...);
+    }(std::make_index_sequence<plan.size()>{});
+}
+
+/// Types serialized with plan copies rather than their generic path
+template <typename T>
+inline constexpr bool planned = (packed_aggregate<T> || is_std_array<T>) && plannable<T>();
+
+}  // namespace detail
+
 /// @brief  Serializer
-/// @param val object supporting serialize method or trivial value to serialize
+/// @param val object supporting serialize method, aggregate or trivial value to serialize
 /// @return byte array representing passed value
-constexpr auto serialize(auto val) // -> std::array<std::byte, SomeSize>
+constexpr auto serialize(const auto& val) // -> std::array<std::byte, SomeSize>
 {
+    using T = std::remove_cvref_t<decltype(val)>;
     if constexpr (requires { val.serialize(); })
     {
         return val.serialize();
     }
-    else if constexpr (std::is_trivially_copyable_v<decltype(val)>)
+    else if constexpr (packed_aggregate<T> || (detail::is_std_array<T> && bin_size_v<T> != sizeof(T)))
+    {
+        std::array<std::byte, bin_size_v<T>> bytes{};
+        if constexpr (detail::planned<T>)
+        {
+            if (!std::is_constant_evaluated())
+            {
+                detail::copy_out(val, bytes.data());
+                return bytes;
+            }
+        }
+        size_t offset = 0;
+        auto write = [&](const auto& field) {
+            std::ranges::copy(Caching::serialize(field), bytes.begin() + offset);
+            offset += bin_size_v<std::remove_cvref_t<decltype(field)>>;
+        };
+        if constexpr (detail::is_std_array<T>)
+        {
+            std::ranges::for_each(val, write);
+        }
+        else
+        {
+            std::apply([&](const auto&... fields) { (write(fields), ...); }, tie_fields(val));
+        }
+        return bytes;
+    }
+    else if constexpr (std::is_trivially_copyable_v<T>)
     {
         return std::bit_cast<std::array<std::byte, sizeof(val)>>(val);
     }
@@ -30,6 +419,33 @@ constexpr auto deserialize(std::span<std::byte, S> bytes) -> T
     {
         return T::deserialize(bytes);
     }
+    else if constexpr (packed_aggregate<T> || (detail::is_std_array<T> && bin_size_v<T> != sizeof(T)))
+    {
+        T obj{};
+        if constexpr (detail::planned<T>)
+        {
+            if (!std::is_constant_evaluated())
+            {
+                detail::copy_in(obj, bytes.data());
+                return obj;
+            }
+        }
+        size_t offset = 0;
+        auto read = [&](auto& field) {
+            using F = std::remove_cvref_t<decltype(field)>;
+            field = Caching::deserialize<F>(std::span<std::byte, bin_size_v<F>>{bytes.data() + offset, bin_size_v<F>});
+            offset += bin_size_v<F>;
+        };
+        if constexpr (detail::is_std_array<T>)
+        {
+            std::ranges::for_each(obj, read);
+        }
+        else
+        {
+            std::apply([&](auto&... fields) { (read(fields), ...); }, tie_fields(obj));
+        }
+        return obj;
+    }
     else if constexpr (std::is_trivial_v<T>)
     {
         T obj;
@@ -39,4 +455,91 @@ constexpr auto deserialize(std::span<std::byte, S> bytes) -> T
     throw std::invalid_argument{"T is neither object of a class with method deserealize nor of a trivial type"};
 }
 
+/// @brief Serializes value into bin_size_v<T> bytes of memory without an intermediate array
+template <typename T>
+constexpr void serialize_to(const T& val, std::byte* out)
+{
+    if constexpr (detail::plannable<T>())
+    {
+        if (!std::is_constant_evaluated())
+        {
+            detail::copy_out(val, out);
+            return;
+        }
+    }
+    const auto bytes = Caching::serialize(val);
+    std::copy(bytes.begin(), bytes.end(), out);
+}
+
+/// @brief Serializes array of values into consecutive records of bin_size_v<T> bytes
+/// Values without padding are copied at once, others by their plan or serialize per value
+/// @param values values to serialize
+/// @param out destination of at least values.size() * bin_size_v<T> bytes
+template <typename T>
+void serialize_n(std::span<const T> values, std::byte* out)
+{
+    if constexpr (detail::plannable<T>() && detail::dense<T>())
+    {
+        std::memcpy(out, values.data(), values.size_bytes());
+    }
+    else
+    {
+        for (const T& value : values)
+        {
+            serialize_to(value, out);
+            out += bin_size_v<T>;
+        }
+    }
+}
+
+/// @brief Deserializes consecutive records of bin_size_v<T> bytes into array of values
+/// @param in source of at least values.size() * bin_size_v<T> bytes
+/// @param values destination
+template <typename T>
+void deserialize_n(const std::byte* in, std::span<T> values)
+{
+    if constexpr (detail::plannable<T>() && detail::dense<T>())
+    {
+        std::memcpy(values.data(), in, values.size_bytes());
+    }
+    else if constexpr (detail::plannable<T>())
+    {
+        for (T& value : values)
+        {
+            detail::copy_in(value, in);
+            in += bin_size_v<T>;
+        }
+    }
+    else
+    {
+        std::array<std::byte, bin_size_v<T>> record;
+        for (T& value : values)
+        {
+            std::memcpy(record.data(), in, record.size());
+            value = Caching::deserialize<T>(std::span{record});
+            in += bin_size_v<T>;
+        }
+    }
+}
+
+/// @brief Compares values with operator== or, for aggregates without it, field by field
+template <typename T>
+constexpr bool equal(const T& lhs, const T& rhs)
+{
+    if constexpr (std::equality_comparable<T>)
+    {
+        return lhs == rhs;
+    }
+    else
+    {
+        static_assert(packed_aggregate<T>, "T is neither equality comparable nor an aggregate");
+        return std::apply(
+            [&](const auto&... left) {
+                return std::apply([&](const auto&... right) { return (Caching::equal(left, right) && ...); },
+                                  tie_fields(rhs));
+            },
+            tie_fields(lhs));
+    }
+}
+
 }  // namespace Caching
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <span>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CACHING_SIMD_X86 1
+#endif
+
+#include "helpers.hpp"
+
+namespace Caching {
+
+namespace simd {
+
+/// @brief Hashing kernel over count records of len bytes placed stride bytes apart and zero padded to stride
+using hash_kernel_t = void (*)(const std::byte* data, size_t stride, size_t len, size_t count, uint64_t* out);
+
+/// @brief Portable kernel, reference for vectorized ones
+inline void hash_packed_scalar(const std::byte* data, size_t stride, size_t len, size_t count, uint64_t* out)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = hash_bytes(std::span{data + i * stride, len});
+    }
+}
+
+#ifdef CACHING_SIMD_X86
+
+/// @brief 64-bit lane-wise multiplication by constant built from 32-bit multiplies
+__attribute__((target("avx2"))) inline __m256i mul64_avx2(__m256i a, __m256i b)
+{
+    const __m256i low = _mm256_mul_epu32(a, b);
+    const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                           _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+
+/// @brief Hashes 4 records per iteration, identical results to hash_bytes
+__attribute__((target("avx2"))) inline void hash_packed_avx2(const std::byte* data, size_t stride, size_t len,
+                                                              size_t count, uint64_t* out)
+{
+    const size_t words = (len + 7) / 8;
+    const __m256i k1 = _mm256_set1_epi64x(static_cast<long long>(0x87c37b91114253d5ull));
+    const __m256i k2 = _mm256_set1_epi64x(static_cast<long long>(0x4cf5ad432745937full));
+    const __m256i f1 = _mm256_set1_epi64x(static_cast<long long>(0xff51afd7ed558ccdull));
+    const __m256i f2 = _mm256_set1_epi64x(static_cast<long long>(0xc4ceb9fe1a85ec53ull));
+    const __m256i init = _mm256_set1_epi64x(static_cast<long long>(len * 0x9e3779b97f4a7c15ull));
+    const __m256i offsets = _mm256_setr_epi64x(0, static_cast<long long>(stride),
+                                               static_cast<long long>(2 * stride), static_cast<long long>(3 * stride));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const auto* base = reinterpret_cast<const long long*>(data + i * stride);
+        __m256i h = init;
+        for (size_t w = 0; w < words; w++)
+        {
+            const __m256i word = _mm256_i64gather_epi64(base + w, offsets, 1);
+            h = _mm256_xor_si256(h, mul64_avx2(word, k1));
+            h = _mm256_or_si256(_mm256_slli_epi64(h, 31), _mm256_srli_epi64(h, 33));
+            h = mul64_avx2(h, k2);
+        }
+        h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 33));
+        h = mul64_avx2(h, f1);
+        h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 33));
+        h = mul64_avx2(h, f2);
+        h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 33));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), h);
+    }
+    hash_packed_scalar(data + i * stride, stride, len, count - i, out + i);
+}
+
+// GCC 12 intrinsic headers trigger false positives on undefined initial vectors
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+/// @brief Hashes 8 records per iteration using native 64-bit multiplies and rotates
+__attribute__((target("avx512f,avx512dq"))) inline void hash_packed_avx512(const std::byte* data, size_t stride,
+                                                                            size_t len, size_t count, uint64_t* out)
+{
+    const size_t words = (len + 7) / 8;
+    const __m512i k1 = _mm512_set1_epi64(static_cast<long long>(0x87c37b91114253d5ull));
+    const __m512i k2 = _mm512_set1_epi64(static_cast<long long>(0x4cf5ad432745937full));
+    const __m512i f1 = _mm512_set1_epi64(static_cast<long long>(0xff51afd7ed558ccdull));
+    const __m512i f2 = _mm512_set1_epi64(static_cast<long long>(0xc4ceb9fe1a85ec53ull));
+    const __m512i init = _mm512_set1_epi64(static_cast<long long>(len * 0x9e3779b97f4a7c15ull));
+    const __m512i offsets = _mm512_mullo_epi64(_mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7),
+                                               _mm512_set1_epi64(static_cast<long long>(stride)));
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const auto* base = reinterpret_cast<const long long*>(data + i * stride);
+        __m512i h = init;
+        for (size_t w = 0; w < words; w++)
+        {
+            const __m512i word = _mm512_i64gather_epi64(offsets, base + w, 1);
+            h = _mm512_xor_si512(h, _mm512_mullo_epi64(word, k1));
+            h = _mm512_mullo_epi64(_mm512_rol_epi64(h, 31), k2);
+        }
+        h = _mm512_xor_si512(h, _mm512_srli_epi64(h, 33));
+        h = _mm512_mullo_epi64(h, f1);
+        h = _mm512_xor_si512(h, _mm512_srli_epi64(h, 33));
+        h = _mm512_mullo_epi64(h, f2);
+        h = _mm512_xor_si512(h, _mm512_srli_epi64(h, 33));
+        _mm512_storeu_si512(out + i, h);
+    }
+    hash_packed_avx2(data + i * stride, stride, len, count - i, out + i);
+}
+
+#pragma GCC diagnostic pop
+
+#endif
+
+/// @brief Selects widest kernel supported by the running CPU
+inline hash_kernel_t best_hash_kernel()
+{
+    static const hash_kernel_t kernel = [] {
+#ifdef CACHING_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+        {
+            return &hash_packed_avx512;
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return &hash_packed_avx2;
+        }
+#endif
+        return &hash_packed_scalar;
+    }();
+    return kernel;
+}
+
+template <typename Key>
+inline constexpr bool packed_hash_v = false;
+
+/// Dependances hash is hash_bytes over packed serialized values, so it can be computed by the kernels
+template <typename... T>
+inline constexpr bool packed_hash_v<Dependances<T...>> = true;
+
+}  // namespace simd
+
+/// @brief Computes std::hash of a batch of keys, Dependances keys are hashed several per instruction stream
+/// @param keys keys to hash
+/// @param out destination for hashes, at least keys.size() long
+template <typename Key>
+void hash_keys(std::span<const Key> keys, std::span<size_t> out)
+{
+    if constexpr (simd::packed_hash_v<Key> && sizeof(size_t) == sizeof(uint64_t))
+    {
+        static constexpr size_t batch = 64;
+        static constexpr size_t stride = (Key::BinSize + 7) / 8 * 8;
+
+        const simd::hash_kernel_t kernel = simd::best_hash_kernel();
+        alignas(64) std::array<std::byte, batch * stride> packed{};
+        for (size_t first = 0; first < keys.size(); first += batch)
+        {
+            const size_t count = std::min(batch, keys.size() - first);
+            for (size_t i = 0; i < count; i++)
+            {
+                const auto bytes = keys[first + i].serialize();
+                std::memcpy(packed.data() + i * stride, bytes.data(), bytes.size());
+            }
+            kernel(packed.data(), stride, Key::BinSize, count, reinterpret_cast<uint64_t*>(out.data() + first));
+        }
+    }
+    else
+    {
+        std::ranges::transform(keys, out.begin(), std::hash<Key>{});
+    }
+}
+
+}  // namespace Caching
@@ -0,0 +1,642 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "serialization.hpp"
+#include "helpers.hpp"
+#include "persistence.hpp"
+#include "prefetch.hpp"
+#include "probes.hpp"
+
+namespace Caching {
+
+/// Location of an object in SlabPool
+struct SlabHandle
+{
+    uint32_t slab = 0;
+    uint32_t slot = 0;
+};
+
+/**
+ * SlabPool class
+ *
+ * Size-class allocator of fixed-size objects
+ * Requests are rounded up to a size class (multiples of 16 up to 64 bytes, then four classes per
+ * power of two) and served from slabs of SlabSize bytes mapped separately, each holding objects
+ * of one class. When its last object is released a slab returns its pages with MADV_DONTNEED
+ * and is kept for reuse by any class, unless it is the only slab of its class. Slabs larger than
+ * SlabSize are unmapped. Objects are addressed by compact handles instead of pointers
+ *
+ * Compaction marks the sparsest slabs of each class for evacuation as long as the other slabs
+ * have room for their objects. Owners move objects out of marked slabs with relocate, at their
+ * own pace, and a marked slab is released once empty
+ */
+class SlabPool
+{
+public:
+    static constexpr size_t SlabSize = 64 << 10;
+    /// Alignment of every object
+    static constexpr size_t Alignment = 16;
+
+    SlabPool() = default;
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    ~SlabPool()
+    {
+        for (const Slab& slab : slabs)
+        {
+            if (slab.base != nullptr)
+            {
+                ::munmap(slab.base, slab.size);
+            }
+        }
+    }
+
+    /// @brief Size of objects serving a request
+    [[nodiscard]] static constexpr size_t size_class(size_t bytes)
+    {
+        if (bytes <= 64)
+        {
+            return round_up(std::max<size_t>(bytes, 1), Alignment);
+        }
+        return round_up(bytes, std::bit_floor(bytes - 1) / 4);
+    }
+
+    /// @brief Allocates uninitialized object memory
+    /// @param bytes object size
+    /// @return handle of the object
+    [[nodiscard]] SlabHandle allocate(size_t bytes)
+    {
+        const size_t object_size = size_class(bytes);
+        std::vector<uint32_t>& partial = classes[object_size];
+        if (partial.empty())
+        {
+            partial.push_back(map_slab(object_size));
+        }
+        const uint32_t index = partial.back();
+        Slab& slab = slabs[index];
+        uint32_t slot = 0;
+        if (!slab.free.empty())
+        {
+            slot = slab.free.back();
+            slab.free.pop_back();
+        }
+        else
+        {
+            slot = slab.used++;
+        }
+        slab.live++;
+        if (slab.live == slab.capacity)
+        {
+            partial.pop_back();
+        }
+        return {index, slot};
+    }
+
+    /// @brief Releases object memory
+    void deallocate(SlabHandle handle)
+    {
+        Slab& slab = slabs[handle.slab];
+        std::vector<uint32_t>& partial = classes[slab.object_size];
+        if (slab.live == slab.capacity && !slab.evacuating)
+        {
+            partial.push_back(handle.slab);
+        }
+        slab.live--;
+        slab.free.push_back(handle.slot);
+        if (slab.live == 0 && (slab.evacuating || partial.size() > 1))
+        {
+            std::erase(partial, handle.slab);
+            release(handle.slab);
+        }
+    }
+
+    /// @brief Marks sparsest slabs of every class for evacuation, they take no new objects
+    /// Empty slabs are released rather than marked, except the last slab of a class
+    /// @return number of marked slabs
+    size_t plan_compaction()
+    {
+        size_t marked = 0;
+        for (auto& [object_size, partial] : classes)
+        {
+            // Sparsest first, densest last where allocate takes them from
+            std::ranges::sort(partial, {}, [&](uint32_t index) { return slabs[index].live; });
+            // Empty slabs kept while they were the last of their class have nothing to evacuate
+            while (partial.size() > 1 && slabs[partial.front()].live == 0)
+            {
+                release(partial.front());
+                partial.erase(partial.begin());
+            }
+            size_t room = 0;
+            for (uint32_t index : partial)
+            {
+                room += slabs[index].capacity - slabs[index].live;
+            }
+            size_t evacuated = 0;
+            while (partial.size() > 1)
+            {
+                Slab& slab = slabs[partial.front()];
+                const size_t own_room = slab.capacity - slab.live;
+                if (room - own_room < evacuated + slab.live)
+                {
+                    break;
+                }
+                room -= own_room;
+                evacuated += slab.live;
+                slab.evacuating = true;
+                partial.erase(partial.begin());
+                marked++;
+            }
+        }
+        return marked;
+    }
+
+    /// @brief Whether object is in a slab marked for evacuation
+    [[nodiscard]] bool evacuating(SlabHandle handle) const
+    {
+        return slabs[handle.slab].evacuating;
+    }
+
+    /// @brief Number of marked slabs still holding objects
+    [[nodiscard]] size_t evacuating_slabs() const
+    {
+        return std::ranges::count_if(slabs, &Slab::evacuating);
+    }
+
+    /// @brief Moves object bytes into a slab not marked for evacuation
+    /// @param handle object to move
+    /// @return new handle of the object, the old one is released
+    [[nodiscard]] SlabHandle relocate(SlabHandle handle)
+    {
+        const size_t object_size = slabs[handle.slab].object_size;
+        const SlabHandle moved = allocate(object_size);
+        std::memcpy(address(moved), address(handle), object_size);
+        deallocate(handle);
+        return moved;
+    }
+
+    /// @brief Memory of an object
+    [[nodiscard]] std::byte* address(SlabHandle handle) const
+    {
+        const Slab& slab = slabs[handle.slab];
+        return slab.base + static_cast<size_t>(handle.slot) * slab.object_size;
+    }
+
+    /// @brief Memory mapped by all slabs
+    [[nodiscard]] size_t mapped_bytes() const
+    {
+        size_t bytes = 0;
+        for (const Slab& slab : slabs)
+        {
+            bytes += slab.size;
+        }
+        return bytes;
+    }
+
+    /// @brief Memory mapped by slabs holding objects
+    [[nodiscard]] size_t resident_bytes() const
+    {
+        size_t bytes = 0;
+        for (const Slab& slab : slabs)
+        {
+            bytes += slab.object_size != 0 ? slab.size : 0;
+        }
+        return bytes;
+    }
+
+    /// @brief Memory of allocated objects including rounding to size classes
+    [[nodiscard]] size_t live_bytes() const
+    {
+        size_t bytes = 0;
+        for (const Slab& slab : slabs)
+        {
+            bytes += static_cast<size_t>(slab.live) * slab.object_size;
+        }
+        return bytes;
+    }
+
+protected:
+    struct Slab
+    {
+        std::byte* base = nullptr;
+        size_t size = 0;
+        uint32_t object_size = 0;
+        uint32_t capacity = 0;
+        /// Slots below it were handed out at least once
+        uint32_t used = 0;
+        uint32_t live = 0;
+        bool evacuating = false;
+        std::vector<uint32_t> free;
+    };
+
+    static constexpr size_t round_up(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    /// @brief Returns pages of an empty slab, keeping SlabSize mappings for reuse
+    void release(uint32_t index)
+    {
+        Slab& slab = slabs[index];
+        if (slab.size == SlabSize)
+        {
+            ::madvise(slab.base, slab.size, MADV_DONTNEED);
+            Slab empty;
+            empty.base = slab.base;
+            empty.size = slab.size;
+            slab = std::move(empty);
+            retained.push_back(index);
+            return;
+        }
+        ::munmap(slab.base, slab.size);
+        slab = Slab{};
+        free_indices.push_back(index);
+    }
+
+    uint32_t map_slab(size_t object_size)
+    {
+        Slab slab;
+        slab.size = round_up(std::max(SlabSize, object_size), static_cast<size_t>(::getpagesize()));
+        if (slab.size == SlabSize && !retained.empty())
+        {
+            const uint32_t index = retained.back();
+            retained.pop_back();
+            slabs[index].object_size = static_cast<uint32_t>(object_size);
+            slabs[index].capacity = static_cast<uint32_t>(SlabSize / object_size);
+            return index;
+        }
+        void* base = ::mmap(nullptr, slab.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+        {
+            throw std::bad_alloc{};
+        }
+        slab.base = static_cast<std::byte*>(base);
+        slab.object_size = static_cast<uint32_t>(object_size);
+        slab.capacity = static_cast<uint32_t>(slab.size / object_size);
+        if (!free_indices.empty())
+        {
+            const uint32_t index = free_indices.back();
+            free_indices.pop_back();
+            slabs[index] = std::move(slab);
+            return index;
+        }
+        slabs.push_back(std::move(slab));
+        return static_cast<uint32_t>(slabs.size() - 1);
+    }
+
+    std::vector<Slab> slabs;
+    /// Slabs with free slots per object size
+    std::unordered_map<size_t, std::vector<uint32_t>> classes;
+    std::vector<uint32_t> free_indices;
+    /// Empty mapped slabs with released pages
+    std::vector<uint32_t> retained;
+};
+
+/**
+ * SlabCache class
+ *
+ * Implements caching with a compact open addressing table
+ * Values larger than InlineLimit are kept out of line in a SlabPool, a table slot then holds only
+ * key, 32-bit hash fingerprint and slab handle, so probing touches few cache lines regardless of
+ * value size. Smaller values are stored in slots. Probing compares fingerprints before keys,
+ * erase shifts following entries back instead of leaving tombstones
+ * Uses the same dump file format as Cache with identical types and Tag
+ *
+ * @tparam Key type of a key
+ * @tparam Value type of cached values, trivially copyable when kept out of line
+ * @tparam Tag file tag string for identificaion
+ * @tparam InlineLimit largest value size stored in table slots
+ */
+template <typename Key, typename Value, StringLiteral Tag = "", size_t InlineLimit = 64>
+class SlabCache
+{
+public:
+    /// Whether values live in the slab pool
+    static constexpr bool out_of_line = sizeof(Value) > InlineLimit;
+
+    static_assert(!out_of_line || std::is_trivially_copyable_v<Value>, "out of line values are moved bytewise");
+    static_assert(alignof(Value) <= SlabPool::Alignment, "slab objects are 16-byte aligned");
+
+    SlabCache()
+    {
+        load_from_file();
+    }
+
+    ~SlabCache()
+    {
+        dump_to_file();
+    }
+
+    SlabCache(const SlabCache&) = delete;
+    SlabCache& operator=(const SlabCache&) = delete;
+
+    /// @brief Getter for file name for cache dump
+    /// @return name of an associated file
+    static const std::string& get_cache_file_name()
+    {
+        static const std::string file_name = Caching::cache_file_name<Key, Value, Tag>();
+        return file_name;
+    }
+
+    /// @brief Obtaines value by provided key if present
+    /// @param key key for value
+    /// @return std::optional for value
+    [[nodiscard]] std::optional<Value> load(const Key& key) const
+    {
+        if (const Slot* slot = find(key))
+        {
+            return value_of(*slot);
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Starts fetching the home slot of the key so a following load hits warm cache lines
+    /// @param key key expected to be loaded soon
+    void prefetch(const Key& key) const
+    {
+        if (!slots.empty())
+        {
+            prefetch_address(&slots[std::hash<Key>{}(key) & (slots.size() - 1)]);
+        }
+    }
+
+    /// @brief Saves value to the cache
+    /// @tparam V type for value. Required for perfect forwarding
+    /// @param deps key for storing value
+    /// @param value value to store at key
+    template <typename V>
+    void store(const Key& deps, V&& value)
+    {
+        if ((count + 1) * 4 > slots.size() * 3)
+        {
+            rehash(std::max<size_t>(16, slots.size() * 2));
+        }
+        const size_t hash = std::hash<Key>{}(deps);
+        const uint32_t fingerprint = fingerprint_of(hash);
+        for (size_t i = hash & (slots.size() - 1);; i = (i + 1) & (slots.size() - 1))
+        {
+            Slot& slot = slots[i];
+            if (slot.fingerprint == 0)
+            {
+                slot.key = deps;
+                slot.fingerprint = fingerprint;
+                emplace(slot, std::forward<V>(value));
+                count++;
+                return;
+            }
+            if (slot.fingerprint == fingerprint && slot.key == deps)
+            {
+                value_of(slot) = std::forward<V>(value);
+                return;
+            }
+        }
+    }
+
+    /// @brief Removes entry releasing its value memory
+    /// @param key key of entry
+    /// @return whether entry was present
+    bool erase(const Key& key)
+    {
+        Slot* slot = const_cast<Slot*>(find(key));
+        if (slot == nullptr)
+        {
+            return false;
+        }
+        release(*slot);
+        count--;
+        // Backward shift keeps probe sequences of following entries unbroken
+        const size_t mask = slots.size() - 1;
+        size_t hole = slot - slots.data();
+        for (size_t i = (hole + 1) & mask; slots[i].fingerprint != 0; i = (i + 1) & mask)
+        {
+            const size_t home = std::hash<Key>{}(slots[i].key) & mask;
+            if (((i - home) & mask) >= ((i - hole) & mask))
+            {
+                slots[hole] = std::move(slots[i]);
+                hole = i;
+            }
+        }
+        slots[hole] = Slot{};
+        return true;
+    }
+
+    /// @brief Moves out of line values from the sparsest slabs into denser ones, emptied slabs
+    /// return their pages to the system
+    /// Continues from where the previous call stopped, so compaction can be spread over many calls
+    /// @param max_moves bound of values moved by the call
+    /// @return whether compaction finished
+    bool compact(size_t max_moves)
+        requires out_of_line
+    {
+        if (!compacting)
+        {
+            if (values.plan_compaction() == 0)
+            {
+                return true;
+            }
+            compacting = true;
+            compact_cursor = 0;
+        }
+        for (; compact_cursor < slots.size() && max_moves > 0; compact_cursor++)
+        {
+            Slot& slot = slots[compact_cursor];
+            if (slot.fingerprint != 0 && values.evacuating(slot.stored))
+            {
+                slot.stored = values.relocate(slot.stored);
+                max_moves--;
+            }
+        }
+        if (compact_cursor == slots.size())
+        {
+            // Another pass if erasures shifted not yet visited slots behind the cursor
+            compact_cursor = 0;
+            compacting = values.evacuating_slabs() != 0;
+        }
+        return !compacting;
+    }
+
+    /// @brief Number of cached entries
+    [[nodiscard]] size_t size() const
+    {
+        return count;
+    }
+
+    /// @brief Allocator of out of line values
+    [[nodiscard]] const SlabPool& pool() const
+    {
+        return values;
+    }
+
+    /// @brief Invokes function for every cached entry
+    /// @param fn callable accepting (const Key&, const Value&)
+    template <typename F>
+    void for_each(F&& fn) const
+    {
+        for (const Slot& slot : slots)
+        {
+            if (slot.fingerprint != 0)
+            {
+                std::invoke(fn, slot.key, value_of(slot));
+            }
+        }
+    }
+
+protected:
+    using Stored = std::conditional_t<out_of_line, SlabHandle, Value>;
+
+    struct Slot
+    {
+        Key key{};
+        /// Mixed hash bits with the lowest bit set, 0 marks an empty slot
+        uint32_t fingerprint = 0;
+        Stored stored{};
+    };
+
+    static uint32_t fingerprint_of(size_t hash)
+    {
+        // Mixed as std::hash of integers is identity
+        return static_cast<uint32_t>(hash_mix(hash) >> 32) | 1;
+    }
+
+    const Slot* find(const Key& key) const
+    {
+        if (slots.empty())
+        {
+            return nullptr;
+        }
+        const size_t hash = std::hash<Key>{}(key);
+        const uint32_t fingerprint = fingerprint_of(hash);
+        for (size_t i = hash & (slots.size() - 1); slots[i].fingerprint != 0; i = (i + 1) & (slots.size() - 1))
+        {
+            if (slots[i].fingerprint == fingerprint && slots[i].key == key)
+            {
+                return &slots[i];
+            }
+        }
+        return nullptr;
+    }
+
+    const Value& value_of(const Slot& slot) const
+    {
+        if constexpr (out_of_line)
+        {
+            return *std::launder(reinterpret_cast<const Value*>(values.address(slot.stored)));
+        }
+        else
+        {
+            return slot.stored;
+        }
+    }
+
+    Value& value_of(Slot& slot)
+    {
+        return const_cast<Value&>(std::as_const(*this).value_of(std::as_const(slot)));
+    }
+
+    template <typename V>
+    void emplace(Slot& slot, V&& value)
+    {
+        if constexpr (out_of_line)
+        {
+            slot.stored = values.allocate(sizeof(Value));
+            ::new (values.address(slot.stored)) Value(std::forward<V>(value));
+        }
+        else
+        {
+            slot.stored = std::forward<V>(value);
+        }
+    }
+
+    void release(Slot& slot)
+    {
+        if constexpr (out_of_line)
+        {
+            values.deallocate(slot.stored);
+        }
+    }
+
+    /// @brief Moves slots into a larger table, out of line values stay in place
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> old = std::exchange(slots, std::vector<Slot>(capacity));
+        for (Slot& slot : old)
+        {
+            if (slot.fingerprint == 0)
+            {
+                continue;
+            }
+            size_t i = std::hash<Key>{}(slot.key) & (capacity - 1);
+            while (slots[i].fingerprint != 0)
+            {
+                i = (i + 1) & (capacity - 1);
+            }
+            slots[i] = std::move(slot);
+        }
+    }
+
+    /// @brief Restores data from an associated file
+    void load_from_file()
+    {
+        static constexpr size_t key_val_size = Key::BinSize + bin_size_v<Value>;
+
+        auto payload = Caching::read_records<Key, Value>(get_cache_file_name());
+        if (!payload)
+        {
+            return;
+        }
+        CACHING_PROBE(file_load_begin, Tag.value);
+        rehash(std::bit_ceil(std::max<size_t>(16, payload->count * 4 / 3 + 1)));
+        std::byte* record = payload->bytes.data();
+        for (size_t i = 0; i < payload->count; i++, record += key_val_size)
+        {
+            store(Caching::deserialize<Key>(std::span<std::byte, Key::BinSize>{record, Key::BinSize}),
+                  Caching::deserialize<Value>(
+                      std::span<std::byte, bin_size_v<Value>>{record + Key::BinSize, bin_size_v<Value>}));
+        }
+        CACHING_PROBE(file_load_end, Tag.value, count, payload->bytes.size());
+    }
+
+    /// @brief Dumps cache content to an associated file
+    void dump_to_file() const
+    {
+        static constexpr size_t key_val_size = Key::BinSize + bin_size_v<Value>;
+
+        CACHING_PROBE(dump_begin, Tag.value, count);
+        std::vector<std::byte> rows(count * key_val_size);
+        std::byte* record = rows.data();
+        for_each([&](const Key& key, const Value& value) {
+            Caching::serialize_to(key, record);
+            Caching::serialize_to(value, record + Key::BinSize);
+            record += key_val_size;
+        });
+        auto file_dump = Caching::write_records<Key, Value>(get_cache_file_name());
+        file_dump.write_rows(rows, record_fields<Key, Value>());
+        file_dump.finish(count);
+        CACHING_PROBE(dump_end, Tag.value, rows.size());
+    }
+
+    std::vector<Slot> slots;
+    size_t count = 0;
+    SlabPool values;
+    bool compacting = false;
+    size_t compact_cursor = 0;
+};
+
+}  // namespace Caching
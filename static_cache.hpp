@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "serialization.hpp"
+#include "helpers.hpp"
+#include "persistence.hpp"
+#include "prefetch.hpp"
+#include "probes.hpp"
+
+namespace Caching {
+
+/**
+ * StaticCache class
+ *
+ * Implements fixed-capacity caching with inline storage and open addressing
+ * Never allocates nor rehashes after construction: lookup and insert probe at most
+ * ProbeLimit slots, when a key does not fit into its probe window a CLOCK-like
+ * eviction replaces an entry not referenced since the previous sweep
+ * Concurrent loads from a shared const cache are safe: they only update access counters, which are
+ * relaxed atomics. Stores require exclusive access
+ * Uses the same dump file format as Cache with identical types and Tag, dumps carry access
+ * counters restoring reference bits and letting the hottest entries be restored first
+ *
+ * @tparam Key type of a key
+ * @tparam Value type of cached values
+ * @tparam N number of slots
+ * @tparam Tag file tag string for identificaion
+ */
+template <typename Key, typename Value, size_t N, StringLiteral Tag = "">
+class StaticCache
+{
+    static_assert(N > 0, "StaticCache requires at least one slot");
+
+public:
+    /// Maximal number of slots visited by any lookup or insertion
+    static constexpr size_t ProbeLimit = std::min<size_t>(N, 8);
+
+    StaticCache() : StaticCache(LoadBudget{}) {}
+
+    /// @param budget limits of restoring the dump file, entries not fitting their probe window
+    /// on restore are dropped rather than evicting hotter ones
+    explicit StaticCache(const LoadBudget& budget)
+    {
+        load_from_file(budget);
+    }
+
+    ~StaticCache()
+    {
+        dump_to_file();
+    }
+
+    /// @brief Getter for file name for cache dump
+    /// @return name of an associated file
+    static const std::string& get_cache_file_name()
+    {
+        static const std::string file_name = Caching::cache_file_name<Key, Value, Tag>();
+        return file_name;
+    }
+
+    /// @brief Obtaines value by provided key if present
+    /// @param key key for value
+    /// @return std::optional for value
+    [[nodiscard]] std::optional<Value> load(const Key& key) const
+    {
+        const size_t home = home_slot(key);
+        for (size_t i = 0; i < ProbeLimit; i++)
+        {
+            const Slot& slot = slots[(home + i) % N];
+            if (!slot.occupied)
+            {
+                break;
+            }
+            if (slot.key == key)
+            {
+                slot.referenced.store(true, std::memory_order_relaxed);
+                // Racing increments may be lost, the counter only ranks entries
+                if (const uint8_t frequency = slot.frequency.load(std::memory_order_relaxed); frequency != UINT8_MAX)
+                {
+                    slot.frequency.store(frequency + 1, std::memory_order_relaxed);
+                }
+                return slot.value;
+            }
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Starts fetching probe window of the key so a following load hits warm cache lines
+    /// @param key key expected to be loaded soon
+    void prefetch(const Key& key) const
+    {
+        const size_t home = home_slot(key);
+        prefetch_address(&slots[home]);
+        prefetch_address(&slots[(home + ProbeLimit - 1) % N]);
+    }
+
+    /// @brief Saves value to the cache evicting an entry if probe window is full
+    /// @tparam V type for value. Required for perfect forwarding
+    /// @param deps key for storing value
+    /// @param value value to store at key
+    template <typename V>
+    void store(const Key& deps, V&& value)
+    {
+        Slot* target = place(deps);
+        if (target == nullptr)
+        {
+            target = &evict(home_slot(deps));
+            target->frequency.store(0, std::memory_order_relaxed);
+        }
+
+        target->key = deps;
+        target->value = std::forward<V>(value);
+        target->referenced.store(true, std::memory_order_relaxed);
+    }
+
+    /// @brief Number of cached entries
+    [[nodiscard]] size_t size() const
+    {
+        return count;
+    }
+
+    /// @brief Maximal number of cached entries
+    [[nodiscard]] static constexpr size_t capacity()
+    {
+        return N;
+    }
+
+    /// @brief Number of entries replaced due to full probe window
+    [[nodiscard]] size_t evictions() const
+    {
+        return evicted;
+    }
+
+    /// @brief Invokes function for every cached entry
+    /// @param fn callable accepting (const Key&, const Value&)
+    template <typename F>
+    void for_each(F&& fn) const
+    {
+        for (const Slot& slot : slots)
+        {
+            if (slot.occupied)
+            {
+                std::invoke(fn, slot.key, slot.value);
+            }
+        }
+    }
+
+protected:
+    struct Slot
+    {
+        Key key{};
+        Value value{};
+        bool occupied = false;
+        mutable std::atomic<bool> referenced = false;
+        /// Loads of the entry, saturating
+        mutable std::atomic<uint8_t> frequency = 0;
+    };
+
+    static size_t home_slot(const Key& key)
+    {
+        return std::hash<Key>{}(key) % N;
+    }
+
+    /// @brief Finds slot holding the key or a free slot in its probe window
+    /// @return slot or nullptr when the window is full of other keys
+    Slot* place(const Key& key)
+    {
+        const size_t home = home_slot(key);
+        for (size_t i = 0; i < ProbeLimit; i++)
+        {
+            Slot& slot = slots[(home + i) % N];
+            if (!slot.occupied)
+            {
+                slot.occupied = true;
+                slot.frequency.store(0, std::memory_order_relaxed);
+                count++;
+                return &slot;
+            }
+            if (slot.key == key)
+            {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    /// @brief Selects victim within probe window clearing reference bits of skipped slots
+    Slot& evict(size_t home)
+    {
+        evicted++;
+        CACHING_PROBE(evict, Tag.value, home);
+        for (size_t i = 0; i < ProbeLimit; i++)
+        {
+            Slot& slot = slots[(home + i) % N];
+            if (!slot.referenced.load(std::memory_order_relaxed))
+            {
+                return slot;
+            }
+            slot.referenced.store(false, std::memory_order_relaxed);
+        }
+        return slots[home];
+    }
+
+    /// @brief Restores data from an associated file hottest entries first
+    void load_from_file(const LoadBudget& budget)
+    {
+        static constexpr size_t key_val_size = Key::BinSize + bin_size_v<Value>;
+
+        auto payload = Caching::read_records<Key, Value>(get_cache_file_name());
+        if (!payload)
+        {
+            return;
+        }
+        CACHING_PROBE(file_load_begin, Tag.value);
+        const auto start = std::chrono::steady_clock::now();
+        const auto order = payload->hotness_order();
+        const size_t entries = budget.entries(order.size(), sizeof(Slot));
+        for (size_t i = 0; i < entries; i++)
+        {
+            if (i % 64 == 63 && std::chrono::steady_clock::now() - start > budget.max_duration)
+            {
+                break;
+            }
+            std::byte* record = payload->bytes.data() + order[i] * key_val_size;
+            auto key = Caching::deserialize<Key>(std::span<std::byte, Key::BinSize>{record, Key::BinSize});
+            Slot* slot = place(key);
+            if (slot == nullptr)
+            {
+                continue;
+            }
+            slot->key = std::move(key);
+            slot->value = Caching::deserialize<Value>(
+                std::span<std::byte, bin_size_v<Value>>{record + Key::BinSize, bin_size_v<Value>});
+            if (!payload->stats.empty())
+            {
+                const AccessStats& stats = payload->stats[order[i]];
+                slot->referenced.store(stats.idle == 0, std::memory_order_relaxed);
+                slot->frequency.store(static_cast<uint8_t>(std::min<uint32_t>(stats.frequency, UINT8_MAX)),
+                                     std::memory_order_relaxed);
+            }
+        }
+        CACHING_PROBE(file_load_end, Tag.value, count, payload->bytes.size());
+    }
+
+    /// @brief Dumps cache content to an associated file
+    void dump_to_file() const
+    {
+        constexpr size_t record_size = Key::BinSize + bin_size_v<Value>;
+        std::vector<std::byte> rows(count * record_size);
+        std::vector<AccessStats> stats;
+        stats.reserve(count);
+        std::byte* record = rows.data();
+        for (const Slot& slot : slots)
+        {
+            if (slot.occupied)
+            {
+                Caching::serialize_to(slot.key, record);
+                Caching::serialize_to(slot.value, record + Key::BinSize);
+                record += record_size;
+                // Reference bits are cleared by sweeps, so an unset bit means idle for at least one
+                stats.push_back({slot.frequency.load(std::memory_order_relaxed),
+                                 slot.referenced.load(std::memory_order_relaxed) ? 0u : 1u});
+            }
+        }
+        auto file_dump = Caching::write_records<Key, Value>(get_cache_file_name());
+        file_dump.write_rows(rows, record_fields<Key, Value>());
+        file_dump.write_access_stats(stats);
+        file_dump.finish(stats.size());
+    }
+
+    std::array<Slot, N> slots{};
+    size_t count = 0;
+    size_t evicted = 0;
+};
+
+}  // namespace Caching
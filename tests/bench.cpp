@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <numeric>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "../cache.hpp"
+#include "../huge_pages.hpp"
+#include "../static_cache.hpp"
+
+namespace {
+
+std::atomic<size_t> allocations = 0;
+
+/// Removes dump file of the cache type when created and destroyed, declared before the cache so
+/// runs start from an empty cache and leave nothing behind
+template <typename CacheT>
+struct FreshDump
+{
+    FreshDump()
+    {
+        std::filesystem::remove(CacheT::get_cache_file_name());
+    }
+
+    ~FreshDump()
+    {
+        std::filesystem::remove(CacheT::get_cache_file_name());
+    }
+};
+
+struct Latency
+{
+    std::vector<long long> samples;
+
+    template <typename F>
+    void measure(F&& fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto finish = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count());
+    }
+
+    void report(std::string_view name)
+    {
+        std::ranges::sort(samples);
+        auto percentile = [&](double p) { return samples[static_cast<size_t>(p * (samples.size() - 1))]; };
+        std::printf("%-40.*s p50 %6lld ns  p99 %6lld ns  p999 %6lld ns  max %8lld ns\n",
+                    static_cast<int>(name.size()), name.data(),
+                    percentile(0.5), percentile(0.99), percentile(0.999), samples.back());
+        samples.clear();
+    }
+};
+
+/// @param allocation_free whether stores and loads must not touch the heap, checked after measuring
+template <typename CacheT>
+void bench_store_load(std::string_view name, const std::vector<int>& keys, bool allocation_free = false)
+{
+    FreshDump<CacheT> fresh;
+    CacheT cache;
+    Latency latency;
+    latency.samples.reserve(keys.size());
+
+    size_t allocations_before = allocations;
+    for (int key : keys)
+    {
+        latency.measure([&] { cache.store({key}, key); });
+    }
+    const size_t store_allocations = allocations - allocations_before;
+    latency.report(std::string{name} + " store");
+    std::printf("%-40s %zu heap allocations during stores\n", "", store_allocations);
+
+    allocations_before = allocations;
+    for (int key : keys)
+    {
+        latency.measure([&] { auto value = cache.load({key}); (void)value; });
+    }
+    const size_t load_allocations = allocations - allocations_before;
+    latency.report(std::string{name} + " load");
+
+    if (allocation_free && (store_allocations != 0 || load_allocations != 0))
+    {
+        std::fprintf(stderr, "%.*s allocated %zu times during stores and %zu times during loads\n",
+                     static_cast<int>(name.size()), name.data(), store_allocations, load_allocations);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+template <typename CacheT>
+void bench_random_lookup(std::string_view name, size_t entries, size_t lookups)
+{
+    std::mt19937_64 gen{7};
+    std::vector<long> keys(entries);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::ranges::shuffle(keys, gen);
+
+    FreshDump<CacheT> fresh;
+    CacheT cache;
+    for (long key : keys)
+    {
+        cache.store({key}, key);
+    }
+
+    std::vector<long> probes(lookups);
+    std::ranges::generate(probes, [&] { return static_cast<long>(gen() % entries); });
+
+    long checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (long key : probes)
+    {
+        checksum += cache.load({key}).value_or(0);
+    }
+    const auto finish = std::chrono::steady_clock::now();
+    const auto total = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+    std::printf("%-40.*s %6.1f ns/lookup over %zu entries (checksum %ld)\n",
+                static_cast<int>(name.size()), name.data(),
+                static_cast<double>(total) / lookups, entries, checksum);
+}
+
+template <typename F>
+double ns_per_item(size_t items, F&& fn)
+{
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const auto finish = std::chrono::steady_clock::now();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count()) / items;
+}
+
+void bench_batched_lookup()
+{
+    using Key = Caching::Dependances<long, long, int>;
+    static constexpr size_t entries = 1 << 16;
+    static constexpr size_t lookups = 1 << 22;
+
+    std::vector<Key> keys;
+    for (size_t i = 0; i < lookups; i++)
+    {
+        const long id = static_cast<long>(i * 2654435761u % (2 * entries));
+        keys.push_back({id, id * 3, static_cast<int>(id)});
+    }
+
+    std::vector<size_t> hashes(keys.size());
+    const double scalar_hash = ns_per_item(keys.size(), [&] {
+        std::ranges::transform(keys, hashes.begin(), std::hash<Key>{});
+    });
+    const double simd_hash = ns_per_item(keys.size(), [&] {
+        Caching::hash_keys(std::span<const Key>{keys}, std::span{hashes});
+    });
+    std::printf("%-40s %6.2f ns/key scalar, %6.2f ns/key SIMD\n", "Hashing Dependances<long, long, int>", scalar_hash, simd_hash);
+
+    using BatchedCache = Caching::ConcurrentCache<Key, long, "BenchBatched">;
+    FreshDump<BatchedCache> fresh;
+    BatchedCache cache;
+    for (size_t i = 0; i < entries; i++)
+    {
+        cache.store(keys[i], static_cast<long>(i));
+    }
+    long checksum = 0;
+    const double scalar_lookup = ns_per_item(keys.size(), [&] {
+        for (const Key& key : keys)
+        {
+            checksum += cache.load(key).value_or(0);
+        }
+    });
+    const double batched_lookup = ns_per_item(keys.size(), [&] {
+        for (size_t first = 0; first < keys.size(); first += 256)
+        {
+            for (const auto& value : cache.load_many(std::span<const Key>{keys}.subspan(first, 256)))
+            {
+                checksum -= value.value_or(0);
+            }
+        }
+    });
+    std::printf("%-40s %6.2f ns/key scalar, %6.2f ns/key batched (checksum %ld)\n", "ConcurrentCache lookups",
+                scalar_lookup, batched_lookup, checksum);
+}
+
+void bench_latency_sampling()
+{
+    using Key = Caching::Dependances<int>;
+    using Stats = Caching::LatencyStats<"BenchSampling">;
+    static constexpr int entries = 1 << 16;
+    static constexpr size_t lookups = 1 << 24;
+
+    using SampledCache = Caching::ConcurrentCache<Key, int, "BenchSampling">;
+    FreshDump<SampledCache> fresh;
+    SampledCache cache;
+    for (int i = 0; i < entries; i++)
+    {
+        cache.store({i}, i);
+    }
+    long checksum = 0;
+    for (const uint32_t every : {0u, 64u, 1u})
+    {
+        Stats::set_sampling(every);
+        const double lookup = ns_per_item(lookups, [&] {
+            for (size_t i = 0; i < lookups; i++)
+            {
+                checksum += cache.load({static_cast<int>(i * 2654435761u % entries)}).value_or(0);
+            }
+        });
+        std::printf("ConcurrentCache load, sampling every %-3u %6.2f ns/key (checksum %ld)\n", every, lookup, checksum);
+    }
+    Stats::set_sampling(0);
+    const auto report = Stats::report(Caching::Operation::Load);
+    std::printf("%-40s p50 %6.0f ns  p99 %6.0f ns  p999 %6.0f ns  max %8.0f ns\n", "Recorded load histogram",
+                report.p50, report.p99, report.p999, report.max);
+}
+
+}  // namespace
+
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    allocations++;
+    if (void* ptr = std::malloc(size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+int main()
+{
+    using namespace Caching;
+
+    std::mt19937 gen{42};
+    std::vector<int> keys(1 << 18);
+    std::ranges::generate(keys, [&] { return static_cast<int>(gen()); });
+
+    std::puts("Store/load latency (random keys)");
+    bench_store_load<Cache<Dependances<int>, int, "Bench">>("Cache", keys);
+    bench_store_load<StaticCache<Dependances<int>, int, 1 << 16, "BenchStatic">>("StaticCache<65536>", keys, true);
+
+    std::puts("Random lookup latency on large table");
+    using HugeAlloc = HugePageAllocator<std::pair<const Dependances<long>, long>>;
+    bench_random_lookup<Cache<Dependances<long>, long, "BenchPages">>("Cache regular pages", 1 << 22, 1 << 23);
+    bench_random_lookup<Cache<Dependances<long>, long, "BenchHugePages", HugeAlloc>>("Cache huge pages", 1 << 22, 1 << 23);
+
+    std::puts("Batched lookups");
+    bench_batched_lookup();
+
+    std::puts("Latency histogram overhead");
+    bench_latency_sampling();
+}
@@ -0,0 +1,2 @@
+# gcc version 11.1.0
+g++ -std=c++20 -Wall -Wextra -Wpedantic -O2 -DNDEBUG ./bench.cpp -o bench
@@ -0,0 +1,382 @@
+// Performance regression harness
+//
+// Runs a fixed matrix of cache scenarios and either records their timings as a baseline
+// or compares them against one:
+//   regress --record baselines/baseline.json
+//   regress --compare baselines/baseline.json [--tolerance 0.15] [--filter mix]
+// A scenario regresses when its median is slower than the baseline median by more than the
+// relative tolerance and by more than NoiseSigmas robust standard deviations of either run
+// Exit code is 1 when any scenario regresses, 2 on invalid usage or unreadable baseline
+// Baselines depend on the machine, record one per machine used for gating. A baseline recorded
+// with another compiler only reports regressions. Scenarios running more threads than the machine
+// has hardware threads are neither recorded nor compared, so a baseline recorded with fewer
+// hardware threads reports threaded scenarios of a larger machine without baseline
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <latch>
+#include <map>
+#include <optional>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../cache.hpp"
+
+namespace {
+
+constexpr double NoiseSigmas = 3.0;
+
+struct Result
+{
+    std::string name;
+    double median_ns = 0;  // per operation
+    double mad_ns = 0;     // median absolute deviation of repetitions
+    size_t runs = 0;
+};
+
+/// Recorded baseline with the environment it was measured in
+struct Baseline
+{
+    std::string compiler;
+    unsigned threads = 0;
+    std::map<std::string, Result> results;
+};
+
+struct Scenario
+{
+    std::string name;
+    std::function<double()> run;  // returns ns per operation of one repetition
+};
+
+double median(std::vector<double> values)
+{
+    std::ranges::sort(values);
+    const size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+Result measure(const Scenario& scenario, size_t reps)
+{
+    scenario.run();  // warm up
+    std::vector<double> samples;
+    for (size_t i = 0; i < reps; i++)
+    {
+        samples.push_back(scenario.run());
+    }
+    const double mid = median(samples);
+    std::vector<double> deviations;
+    for (double sample : samples)
+    {
+        deviations.push_back(std::abs(sample - mid));
+    }
+    return {scenario.name, mid, median(deviations), reps};
+}
+
+template <typename F>
+double elapsed_ns(F&& fn)
+{
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+/// Load/store mix on a prepopulated ConcurrentCache, ns per operation across all threads
+double run_mix(unsigned load_percent, unsigned threads, int entries)
+{
+    using CacheT = Caching::ConcurrentCache<Caching::Dependances<int>, int, "RegressMix">;
+    static constexpr size_t ops_per_thread = 1 << 17;
+
+    std::remove(CacheT::get_cache_file_name().c_str());
+    std::optional<CacheT> cache{std::in_place};
+    for (int i = 0; i < entries; i++)
+    {
+        cache->store({i}, i);
+    }
+
+    std::latch start{threads + 1};
+    std::vector<std::jthread> workers;
+    std::atomic<long> checksum = 0;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t] {
+            uint32_t state = 2654435761u * (t + 1);
+            long sum = 0;
+            start.arrive_and_wait();
+            for (size_t i = 0; i < ops_per_thread; i++)
+            {
+                state = state * 1664525u + 1013904223u;
+                const int key = static_cast<int>((state >> 8) % static_cast<uint32_t>(entries));
+                if ((state >> 24) % 100 < load_percent)
+                {
+                    sum += cache->load({key}).value_or(0);
+                }
+                else
+                {
+                    cache->store({key}, key);
+                }
+            }
+            checksum += sum;
+        });
+    }
+    const double ns = elapsed_ns([&] {
+        start.arrive_and_wait();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    });
+    cache.reset();
+    std::remove(CacheT::get_cache_file_name().c_str());
+    return ns / static_cast<double>(ops_per_thread * threads);
+}
+
+using DumpCache = Caching::Cache<Caching::Dependances<long, int>, double, "RegressDump">;
+
+/// Writing a dump of given size on destruction, ns per entry
+double run_dump(int entries)
+{
+    std::remove(DumpCache::get_cache_file_name().c_str());
+    std::optional<DumpCache> cache{std::in_place};
+    for (int i = 0; i < entries; i++)
+    {
+        cache->store({i * 7L, i}, i * 0.5);
+    }
+    return elapsed_ns([&] { cache.reset(); }) / entries;
+}
+
+/// Constructing a cache from a dump of given size, ns per entry
+double run_startup(int entries)
+{
+    run_dump(entries);
+    std::optional<DumpCache> cache;
+    const double ns = elapsed_ns([&] { cache.emplace(); });
+    if (cache->size() != static_cast<size_t>(entries))
+    {
+        std::fprintf(stderr, "startup scenario restored %zu of %d entries\n", cache->size(), entries);
+        std::exit(2);
+    }
+    cache.reset();
+    std::remove(DumpCache::get_cache_file_name().c_str());
+    return ns / entries;
+}
+
+std::vector<Scenario> scenarios()
+{
+    std::vector<Scenario> result;
+    for (unsigned load_percent : {100u, 90u, 50u})
+    {
+        for (unsigned threads : {1u, 2u, 4u})
+        {
+            for (int entries : {1 << 10, 1 << 16})
+            {
+                result.push_back({"mix/load" + std::to_string(load_percent) + "/threads" + std::to_string(threads)
+                                      + "/entries" + std::to_string(entries),
+                                  [=] { return run_mix(load_percent, threads, entries); }});
+            }
+        }
+    }
+    for (int entries : {1 << 12, 1 << 18})
+    {
+        result.push_back({"dump/entries" + std::to_string(entries), [=] { return run_dump(entries); }});
+        result.push_back({"startup/entries" + std::to_string(entries), [=] { return run_startup(entries); }});
+    }
+    return result;
+}
+
+void write_results(const std::string& path, const std::vector<Result>& results)
+{
+    std::ofstream out{path};
+    out << "{\n  \"compiler\": \"" << __VERSION__ << "\",\n  \"threads\": " << std::thread::hardware_concurrency()
+        << ",\n  \"scenarios\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& r = results[i];
+        char line[256];
+        std::snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"median_ns\": %.3f, \"mad_ns\": %.3f, \"runs\": %zu}%s\n",
+                      r.name.c_str(), r.median_ns, r.mad_ns, r.runs, i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+}
+
+std::optional<Baseline> read_results(const std::string& path)
+{
+    std::ifstream in{path};
+    if (!in)
+    {
+        return std::nullopt;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string text = buffer.str();
+
+    static const std::regex entry{
+        R"re(\{\s*"name":\s*"([^"]+)",\s*"median_ns":\s*([-+.eE0-9]+),\s*"mad_ns":\s*([-+.eE0-9]+),\s*"runs":\s*([0-9]+)\s*\})re"};
+    static const std::regex compiler{R"re("compiler":\s*"([^"]*)")re"};
+    static const std::regex threads{R"re("threads":\s*([0-9]+))re"};
+    Baseline baseline;
+    if (std::smatch match; std::regex_search(text, match, compiler))
+    {
+        baseline.compiler = match[1];
+    }
+    if (std::smatch match; std::regex_search(text, match, threads))
+    {
+        baseline.threads = static_cast<unsigned>(std::stoul(match[1]));
+    }
+    for (auto it = std::sregex_iterator{text.begin(), text.end(), entry}; it != std::sregex_iterator{}; ++it)
+    {
+        const auto& match = *it;
+        baseline.results[match[1]] = {match[1], std::stod(match[2]), std::stod(match[3]), std::stoul(match[4])};
+    }
+    return baseline;
+}
+
+/// @brief Number of threads a scenario runs, 1 for scenarios without a threads component
+unsigned scenario_threads(const std::string& name)
+{
+    const size_t pos = name.find("/threads");
+    return pos == std::string::npos ? 1 : static_cast<unsigned>(std::strtoul(name.c_str() + pos + 8, nullptr, 10));
+}
+
+/// Robust standard deviation estimate from median absolute deviation
+double sigma(const Result& r)
+{
+    return 1.4826 * r.mad_ns;
+}
+
+int usage()
+{
+    std::fputs("usage: regress (--record FILE | --compare FILE) [--tolerance FRACTION] [--reps N] [--filter TEXT]\n",
+               stderr);
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::string record_path;
+    std::string compare_path;
+    std::string filter;
+    double tolerance = 0.15;
+    size_t reps = 7;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        if (i + 1 == argc)
+        {
+            return usage();
+        }
+        const char* value = argv[++i];
+        if (arg == "--record")
+        {
+            record_path = value;
+        }
+        else if (arg == "--compare")
+        {
+            compare_path = value;
+        }
+        else if (arg == "--tolerance")
+        {
+            tolerance = std::atof(value);
+        }
+        else if (arg == "--reps")
+        {
+            reps = std::max(std::atoi(value), 1);
+        }
+        else if (arg == "--filter")
+        {
+            filter = value;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    if (record_path.empty() == compare_path.empty())
+    {
+        return usage();
+    }
+
+    std::optional<Baseline> baseline;
+    // Scenarios with more threads would measure oversubscription rather than the cache
+    const unsigned max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    bool same_compiler = true;
+    if (!compare_path.empty())
+    {
+        baseline = read_results(compare_path);
+        if (!baseline || baseline->results.empty())
+        {
+            std::fprintf(stderr, "cannot read baseline %s\n", compare_path.c_str());
+            return 2;
+        }
+        same_compiler = baseline->compiler == __VERSION__;
+        if (!same_compiler)
+        {
+            std::fprintf(stderr, "warning: baseline compiled with %s, running %s, regressions do not fail\n",
+                         baseline->compiler.c_str(), __VERSION__);
+        }
+        if (baseline->threads != max_threads)
+        {
+            std::fprintf(stderr, "warning: baseline recorded with %u hardware threads, running with %u, scenarios with more "
+                                 "than %u threads have no baseline\n",
+                         baseline->threads, max_threads, std::min(baseline->threads, max_threads));
+        }
+    }
+
+    std::vector<Result> results;
+    size_t regressions = 0;
+    for (const Scenario& scenario : scenarios())
+    {
+        if (scenario.name.find(filter) == std::string::npos || scenario_threads(scenario.name) > max_threads)
+        {
+            continue;
+        }
+        const Result current = measure(scenario, reps);
+        results.push_back(current);
+
+        if (!baseline)
+        {
+            std::printf("%-40s %10.2f ns/op  +- %.2f\n", current.name.c_str(), current.median_ns, sigma(current));
+            continue;
+        }
+        const auto it = baseline->results.find(current.name);
+        if (it == baseline->results.end())
+        {
+            std::printf("%-40s %10.2f ns/op  (no baseline)\n", current.name.c_str(), current.median_ns);
+            continue;
+        }
+        const Result& base = it->second;
+        const double delta = current.median_ns - base.median_ns;
+        const double noise = NoiseSigmas * std::max(sigma(base), sigma(current));
+        const bool significant = std::abs(delta) > tolerance * base.median_ns && std::abs(delta) > noise;
+        const char* verdict = !significant ? "ok" : delta > 0 ? "REGRESSION" : "improved";
+        regressions += significant && delta > 0;
+        std::printf("%-40s %10.2f -> %10.2f ns/op  %+7.1f%%  %s\n", current.name.c_str(), base.median_ns,
+                    current.median_ns, 100 * delta / base.median_ns, verdict);
+    }
+
+    if (!record_path.empty())
+    {
+        write_results(record_path, results);
+        std::printf("recorded %zu scenarios to %s\n", results.size(), record_path.c_str());
+        return 0;
+    }
+    if (regressions > 0)
+    {
+        std::printf("%zu scenario(s) regressed beyond %.0f%% and noise\n", regressions, tolerance * 100);
+        return same_compiler ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,8 @@
+# gcc version 11.1.0
+# Compares current performance with the stored baseline, exits non-zero on regression
+# ./regress.sh --record baselines/baseline.json records a new baseline instead
+g++ -std=c++20 -Wall -Wextra -Wpedantic -O2 -DNDEBUG ./regress.cpp -o regress || exit 2
+if [ "$#" -eq 0 ]; then
+    set -- --compare baselines/baseline.json
+fi
+./regress "$@"
@@ -1,7 +1,89 @@
+#include <atomic>
 #include <cassert>
 #include <complex>
+#include <cstdlib>
+#include <latch>
+#include <limits>
+#include <new>
 
 #include "../cache.hpp"
+#include "../columnar_cache.hpp"
+#include "../compression.hpp"
+#include "../fingerprint.hpp"
+#include "../huge_pages.hpp"
+#include "../interned_cache.hpp"
+#include "../numa_cache.hpp"
+#include "../slab_cache.hpp"
+#include "../static_cache.hpp"
+#include "../tiered_cache.hpp"
+
+// Embedded tables must be visible before caches with their Tags are used
+namespace Caching {
+
+inline constexpr auto embedded_test_table = make_embedded_table(std::array{
+    std::pair{Dependances<int, short>{1, 2}, 1.5}, std::pair{Dependances<int, short>{2, 3}, 2.5},
+    std::pair{Dependances<int, short>{3, 4}, 3.5}});
+
+template <>
+inline constexpr EmbeddedDump embedded_dump<"Embedded"> = embedded_test_table.dump();
+
+template <>
+inline constexpr EmbeddedDump embedded_dump<"EmbeddedOverlay"> = embedded_test_table.dump(true);
+
+struct Point { int x, y; };
+struct VersionedPoint { int x, y; };
+
+template <>
+inline constexpr uint32_t schema_version<VersionedPoint> = 2;
+
+struct Reading { char sensor; double value; short unit; };
+struct Sample { int id; Reading reading; std::array<short, 2> flags; };
+struct Extent { int width; int height; float scale; };
+
+/// Arena of single huge page chunks, so small tables span several chunks
+inline HugePageArena& small_chunk_arena()
+{
+    static HugePageArena arena{HugePageMode::None, HugePageArena::HugePageSize};
+    return arena;
+}
+
+template <typename T>
+struct SmallChunkAllocator : HugePageAllocator<T>
+{
+    SmallChunkAllocator() noexcept : HugePageAllocator<T>{small_chunk_arena()} {}
+
+    template <typename U>
+    SmallChunkAllocator(const SmallChunkAllocator<U>& other) noexcept : HugePageAllocator<T>{other} {}
+};
+
+}  // namespace Caching
+
+namespace {
+
+/// Heap allocations made through the replaced operator new
+std::atomic<size_t> allocations = 0;
+
+}  // namespace
+
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
 
 int main() {
     using namespace Caching;
@@ -38,4 +120,861 @@ int main() {
 
         stored = cache.load({1});
     }
+
+    { // Iteration
+        Cache<Dependances<int>, int, "Iteration"> cache;
+        for (int i = 0; i < 10000; i++)
+        {
+            cache.store({i}, i);
+        }
+        assert(cache.size() == 10000 && std::ranges::size(cache.entries()) == 10000);
+
+        long long sum = 0;
+        cache.for_each([&](const auto&, int value) { sum += value; });
+
+        std::atomic<long long> par_sum = 0;
+        cache.for_each(execution::par.on(4), [&](const auto&, int value) { par_sum += value; });
+        assert(sum == 49995000 && par_sum == sum);
+    }
+
+    { // Concurrent iteration
+        ConcurrentCache<Dependances<int>, int, "Iteration"> cache;
+        std::atomic<int> count = 0;
+        cache.for_each(execution::par, [&](const auto&, int) { count++; });
+        assert(count == 10000 && cache.entries().size() == 10000);
+    }
+
+    { // Static cache
+        StaticCache<Dependances<int>, int, 64, "Static"> cache;
+        [[maybe_unused]] const size_t allocations_before = allocations;
+        for (int i = 0; i < 1000; i++)
+        {
+            cache.store({i}, i);
+            [[maybe_unused]] auto stored = cache.load({i});
+            assert(stored.has_value() && stored.value() == i);
+        }
+        // Slots are preallocated, stores and loads never touch the heap
+        assert(allocations == allocations_before);
+        assert(cache.size() <= cache.capacity() && cache.evictions() > 0);
+    }
+
+    { // Static cache from dump file
+        StaticCache<Dependances<int>, int, 64, "Static"> cache;
+        Cache<Dependances<int>, int, "Static"> same_file;
+        assert(cache.size() > 0 && cache.size() <= same_file.size());
+        cache.for_each([&]([[maybe_unused]] const auto& key, [[maybe_unused]] int value) {
+            assert(same_file.load(key) == value);
+        });
+
+        const auto& shared = cache;
+        std::vector<std::jthread> readers;
+        for (int t = 0; t < 4; t++)
+        {
+            readers.emplace_back([&] {
+                shared.for_each([&]([[maybe_unused]] const auto& key, [[maybe_unused]] int value) {
+                    assert(shared.load(key) == value);
+                });
+            });
+        }
+    }
+
+    { // Hottest entries restored first
+        using Hot = StaticCache<Dependances<int>, int, 64, "Hot">;
+        std::remove(Hot::get_cache_file_name().c_str());
+        {
+            Hot cache;
+            for (int i = 0; i < 40; i++)
+            {
+                cache.store({i}, i);
+            }
+            for (int round = 0; round < 3; round++)
+            {
+                for (int i = 30; i < 40; i++)
+                {
+                    assert(cache.load({i}) == i);
+                }
+            }
+        }
+        const auto payload = read_records<Dependances<int>, int>(Hot::get_cache_file_name());
+        assert(payload && payload->count == 40 && payload->stats.size() == 40);
+
+        Hot cache{LoadBudget{.max_entries = 10}};
+        assert(cache.size() == 10);
+        for (int i = 30; i < 40; i++)
+        {
+            assert(cache.load({i}) == i);
+        }
+
+        // Cache reading the same file keeps the hottest entries within its budget as well
+        ConcurrentCache<Dependances<int>, int, "Hot"> budgeted{LoadBudget{.max_entries = 10}};
+        assert(budgeted.size() == 10);
+        for (int i = 30; i < 40; i++)
+        {
+            assert(budgeted.load({i}) == i);
+        }
+        [[maybe_unused]] const Cache<Dependances<int>, int, "Hot"> nothing{LoadBudget{.max_bytes = 0}};
+        assert(nothing.size() == 0);
+    }
+
+    { // Huge page arena
+        using Alloc = HugePageAllocator<std::pair<const Dependances<int>, int>>;
+        Cache<Dependances<int>, int, "HugePages", Alloc> cache;
+        for (int i = 0; i < 100000; i++)
+        {
+            cache.store({i}, i);
+        }
+        assert(HugePageArena::global().mapped_bytes() > 0);
+    }
+
+    { // Huge page arena from dump file
+        HugePageArena arena{HugePageMode::Explicit, HugePageArena::HugePageSize};
+        std::vector<int, HugePageAllocator<int>> values{HugePageAllocator<int>{arena}};
+        values.resize(1 << 20, 1);
+
+        using Alloc = HugePageAllocator<std::pair<const Dependances<int>, int>>;
+        ConcurrentCache<Dependances<int>, int, "HugePages", Alloc> cache;
+        assert(cache.size() == 100000 && cache.load({99999}) == 99999);
+    }
+
+    { // Arena compaction
+        HugePageArena arena{HugePageMode::None, HugePageArena::HugePageSize};
+        std::vector<void*> blocks;
+        for (size_t i = 0; i < 3 * HugePageArena::HugePageSize / 4096; i++)
+        {
+            blocks.push_back(arena.allocate(4096));
+        }
+        for (size_t i = 1; i < 512; i++)
+        {
+            arena.deallocate(blocks[i], 4096);
+        }
+        assert(arena.sparse(blocks[0]) && !arena.sparse(blocks[600]) && !arena.sparse(blocks.back()));
+        arena.deallocate(blocks[0], 4096);
+        assert(arena.trim() == HugePageArena::HugePageSize && arena.trim() == 0);
+
+        // Oversized chunks are unmapped on release, chunks mapped after them are still found
+        [[maybe_unused]] const size_t mapped = arena.mapped_bytes();
+        void* first = arena.allocate(2 * HugePageArena::HugePageSize);
+        void* second = arena.allocate(2 * HugePageArena::HugePageSize);
+        arena.deallocate(first, 2 * HugePageArena::HugePageSize);
+        assert(arena.mapped_bytes() > mapped && !arena.sparse(second));
+        arena.deallocate(second, 2 * HugePageArena::HugePageSize);
+        assert(arena.mapped_bytes() == mapped);
+
+        // Prefaulted tail of a chunk left behind by the current one is returned while it has live memory
+        HugePageArena tails{HugePageMode::None, HugePageArena::HugePageSize};
+        void* head = tails.allocate(4096);
+        tails.prefault(4096);
+        void* next = tails.allocate(HugePageArena::HugePageSize - 4096 + 16);
+        assert(tails.trim() == HugePageArena::HugePageSize - 4096 && tails.trim() == 0);
+        tails.deallocate(next, HugePageArena::HugePageSize - 4096 + 16);
+        tails.deallocate(head, 4096);
+
+        using Alloc = HugePageAllocator<std::pair<const Dependances<int>, int>>;
+        ConcurrentCache<Dependances<int>, int, "Compacted", Alloc> cache;
+        for (int i = 0; i < 1000; i++)
+        {
+            cache.store({i}, i);
+        }
+        while (!cache.compact(100))
+        {
+        }
+        assert(cache.load({999}) == 999 && cache.size() == 1000);
+
+        // Nodes interleaved with those of a destroyed cache are moved, then the bucket array is reallocated
+        using SmallChunks = SmallChunkAllocator<std::pair<const Dependances<int>, int>>;
+        using Churned = Cache<Dependances<int>, int, "CompactedChurn", SmallChunks>;
+        using Dropped = Cache<Dependances<int>, int, "CompactedDropped", SmallChunks>;
+        std::remove(Churned::get_cache_file_name().c_str());
+        Churned churned;
+        {
+            Dropped dropped;
+            for (int i = 0; i < 100000; i++)
+            {
+                churned.store({i}, i);
+                dropped.store({i}, i);
+                dropped.store({-i - 1}, i);
+            }
+        }
+        std::remove(Dropped::get_cache_file_name().c_str());
+        while (!churned.compact(1000))
+        {
+        }
+        for (int i = 0; i < 100000; i += 97)
+        {
+            assert(churned.load({i}) == i);
+        }
+        assert(churned.size() == 100000 && small_chunk_arena().mapped_bytes() > 2 * HugePageArena::HugePageSize);
+    }
+
+    { // Slab compaction
+        using Large = std::array<double, 64>;
+        using Slabbed = SlabCache<Dependances<int>, Large, "SlabCompacted">;
+        std::remove(Slabbed::get_cache_file_name().c_str());
+        Slabbed cache;
+        for (int i = 0; i < 1024; i++)
+        {
+            Large large;
+            large.fill(i);
+            cache.store({i}, large);
+        }
+        for (int i = 0; i < 1024; i++)
+        {
+            if (i % 8 != 0)
+            {
+                cache.erase({i});
+            }
+        }
+        assert(cache.pool().resident_bytes() == 8 * SlabPool::SlabSize);
+        size_t calls = 1;
+        while (!cache.compact(16))
+        {
+            calls++;
+        }
+        [[maybe_unused]] const bool finished = cache.compact(16);
+        assert(calls > 2 && cache.pool().resident_bytes() == SlabPool::SlabSize && finished);
+        for (int i = 0; i < 1024; i += 8)
+        {
+            assert((*cache.load({i}))[0] == i);
+        }
+
+        // An empty slab sorted first does not stop planning
+        SlabPool pool;
+        std::vector<SlabHandle> handles;
+        for (size_t i = 0; i < 3 * SlabPool::SlabSize / 512; i++)
+        {
+            handles.push_back(pool.allocate(512));
+        }
+        const size_t per_slab = SlabPool::SlabSize / 512;
+        // The last slab is emptied first, so it is kept as the only partial slab of the class
+        for (size_t i = 3 * per_slab; i-- > 0;)
+        {
+            if (i >= 2 * per_slab || i % per_slab != 0)
+            {
+                pool.deallocate(handles[i]);
+            }
+        }
+        assert(pool.resident_bytes() == 3 * SlabPool::SlabSize);
+        [[maybe_unused]] const size_t marked = pool.plan_compaction();
+        assert(marked == 1 && pool.resident_bytes() == 2 * SlabPool::SlabSize && pool.evacuating_slabs() == 1);
+        const SlabHandle evacuated = pool.evacuating(handles[0]) ? handles[0] : handles[per_slab];
+        [[maybe_unused]] const SlabHandle moved = pool.relocate(evacuated);
+        assert(!pool.evacuating(moved) && pool.resident_bytes() == SlabPool::SlabSize);
+    }
+
+    { // NUMA topology
+        assert((NumaTopology::parse_cpu_list("0-3,8,10-11") == std::vector<unsigned>{0, 1, 2, 3, 8, 10, 11}));
+        assert(NumaTopology::detect().node_count() >= 1);
+    }
+
+    { // Replicated cache on emulated nodes
+        ReplicatedCache<Dependances<int>, int, "Replicated"> cache{NumaTopology::emulated(3), 4};
+        assert(cache.node_count() == 3);
+        cache.store({1}, -1);
+        assert(cache.load_on(1, {1}) != -1);
+        cache.flush();
+        for (unsigned node = 0; node < cache.node_count(); node++)
+        {
+            assert(cache.load_on(node, {1}) == -1);
+        }
+        cache.store({1}, 1);
+        for (int i = 2; i < 6; i++)
+        {
+            cache.store({i}, i);
+        }
+        assert(cache.load_on(2, {4}) == 4);
+    }
+
+    { // Replicated cache from dump file
+        ReplicatedCache<Dependances<int>, int, "Replicated"> cache{NumaTopology::emulated(2)};
+        assert(cache.load_on(1, {5}) == 5 && cache.size() == 5);
+    }
+
+    { // Fingerprint keys
+        using Key = Fingerprint<Dependances<long, long, double>>;
+        static_assert(sizeof(Key) == 8 && sizeof(Fingerprint<Dependances<int>, 128>) == 16);
+        static_assert(Key::collision_probability(1e6) < 3e-8);
+        // Fingerprints of different keys have the same size but never share dumps
+        static_assert(type_fingerprint<Fingerprint<Dependances<int64_t>>, int> != type_fingerprint<Fingerprint<Dependances<double>>, int>);
+        static_assert(type_fingerprint<Key, int> != type_fingerprint<Fingerprint<Dependances<long, double, long>>, int>);
+
+        Cache<Key, int, "Fingerprint"> cache;
+        cache.store({1l, 2l, 3.0}, 1);
+        assert(cache.load({1l, 2l, 3.0}) == 1 && !cache.load({2l, 1l, 3.0}).has_value());
+    }
+
+    { // Fingerprint keys from dump file
+        Cache<Fingerprint<Dependances<long, long, double>>, int, "Fingerprint"> cache;
+        assert(cache.load({1l, 2l, 3.0}) == 1);
+    }
+
+    { // Interned values
+        using Table = std::array<double, 512>;
+        Table first{};
+        Table second{};
+        second.fill(1.0);
+
+        InternedCache<Dependances<int>, Table, "Interned"> cache;
+        for (int i = 0; i < 100; i++)
+        {
+            cache.store({i}, i % 2 ? first : second);
+        }
+        assert(cache.size() == 100 && cache.unique_values() == 2);
+        assert(cache.load_shared({1}) == cache.load_shared({3}) && cache.load({2}) == second);
+    }
+
+    { // Interned values from dump file
+        InternedCache<Dependances<int>, std::array<double, 512>, "Interned"> cache;
+        assert(cache.size() == 100 && cache.unique_values() == 2 && (*cache.load({3}))[0] == 0.0);
+        cache.store({3}, std::array<double, 512>{});
+        assert(cache.unique_values() == 2);
+    }
+
+    { // Released values collected while interning
+        ValuePool<int> pool;
+        const auto kept = pool.intern(-1);
+        for (int i = 0; i < 10000; i++)
+        {
+            [[maybe_unused]] const auto released = pool.intern(i);
+        }
+        assert(pool.size() == 1 && pool.tracked() <= 18);
+    }
+
+    { // Compressed cold tier
+        using Row = std::array<double, 16>;
+        using Tiered = TieredCache<Dependances<int>, Row, "Tiered">;
+        std::remove(Tiered::get_cache_file_name().c_str());
+        Tiered cache;
+        for (int i = 0; i < 200; i++)
+        {
+            Row row;
+            row.fill(i % 4);
+            cache.store({i}, row);
+        }
+        [[maybe_unused]] const size_t demoted = cache.demote_idle(0);
+        assert(demoted == 200 && cache.hot_size() == 0 && cache.cold_size() == 200);
+        assert(cache.cold_bytes() * 4 < 200 * sizeof(Row));
+        assert((*cache.load({7}))[15] == 3.0 && cache.hot_size() == 1 && cache.cold_size() == 199);
+        cache.store({8}, Row{});
+        assert(cache.size() == 200 && (*cache.load({8}))[0] == 0.0);
+
+        cache.set_idle_limit(10);
+        for (int i = 0; i < 20; i++)
+        {
+            assert(cache.load({7}).has_value());
+        }
+        assert(cache.hot_size() == 1);
+        size_t sum = 0;
+        cache.for_each([&](const Dependances<int>&, const Row& row) { sum += row[0]; });
+        assert(sum == 50 * (0 + 1 + 2 + 3));
+    }
+
+    { // Compressed cold tier from dump file
+        using Tiered = TieredCache<Dependances<int>, std::array<double, 16>, "Tiered">;
+        const auto payload = read_records<Dependances<int>, std::array<double, 16>>(Tiered::get_cache_file_name());
+        assert(payload && payload->stats.size() == 200);
+        assert(payload->stats[payload->hotness_order().front()].frequency == 21);
+
+        Tiered cache{LoadBudget{.max_entries = 2}};
+        assert(cache.size() == 2 && cache.cold_size() == 2 && (*cache.load({7}))[0] == 3.0);
+    }
+
+    { // Out of line slab values
+        using Large = std::array<double, 64>;
+        using Slabbed = SlabCache<Dependances<int>, Large, "Slab">;
+        static_assert(Slabbed::out_of_line && !SlabCache<Dependances<int>, int, "SlabInline">::out_of_line);
+        static_assert(SlabPool::size_class(1) == 16 && SlabPool::size_class(65) == 80 && SlabPool::size_class(512) == 512);
+        std::remove(Slabbed::get_cache_file_name().c_str());
+        Slabbed cache;
+        for (int i = 0; i < 1000; i++)
+        {
+            Large large;
+            large.fill(i);
+            cache.store({i}, large);
+        }
+        assert(cache.size() == 1000 && cache.pool().live_bytes() == 1000 * sizeof(Large));
+        for (int i = 0; i < 1000; i += 2)
+        {
+            [[maybe_unused]] const bool erased = cache.erase({i});
+            assert(erased);
+        }
+        [[maybe_unused]] const bool erased_again = cache.erase({0});
+        assert(!erased_again && !cache.load({0}) && cache.size() == 500);
+        for (int i = 1; i < 1000; i += 2)
+        {
+            assert((*cache.load({i}))[63] == i);
+        }
+        cache.store({1}, Large{});
+        assert((*cache.load({1}))[0] == 0.0 && cache.pool().live_bytes() == 500 * sizeof(Large));
+    }
+
+    { // Out of line slab values from dump file
+        SlabCache<Dependances<int>, std::array<double, 64>, "Slab"> cache;
+        assert(cache.size() == 500 && (*cache.load({999}))[0] == 999.0 && !cache.load({998}));
+    }
+
+    { // Columnar storage
+        using Columnar = ColumnarCache<Dependances<int, double>, float, "Columnar">;
+        std::remove(Columnar::get_cache_file_name().c_str());
+        Columnar cache;
+        for (int i = 0; i < 100; i++)
+        {
+            cache.store({i, i * 0.5}, i * 2.0f);
+        }
+        cache.store({3, 1.5}, -1.0f);
+        assert(cache.size() == 100 && cache.load({3, 1.5}) == -1.0f && !cache.load({3, 2.0}));
+        assert(cache.column<0>()[10] == 10 && cache.column<1>()[10] == 5.0 && cache.value_column()[10] == 20.0f);
+        assert(cache.count_if<1>([](double val) { return val >= 25.0; }) == 50);
+
+        [[maybe_unused]] const bool erased = cache.erase({0, 0.0});
+        [[maybe_unused]] const bool erased_again = cache.erase({0, 0.0});
+        assert(erased && !erased_again);
+        assert(cache.column<0>()[0] == 99 && cache.load({99, 49.5}) == 198.0f);
+        [[maybe_unused]] const size_t invalidated = cache.invalidate_if<0>([](int val) { return val % 2 == 1; });
+        assert(invalidated == 50);
+        assert(cache.size() == 49 && !cache.load({99, 49.5}) && cache.load({98, 49.0}) == 196.0f);
+        cache.store({1, 0.5}, 1.0f);
+        assert(cache.size() == 50 && cache.load({1, 0.5}) == 1.0f);
+    }
+
+    { // Columnar storage from dump file
+        ColumnarCache<Dependances<int, double>, float, "Columnar"> cache;
+        assert(cache.size() == 50 && cache.load({98, 49.0}) == 196.0f && cache.count_if<0>([](int val) { return val < 10; }) == 5);
+    }
+
+    { // Precomputed hash keys
+        static constexpr auto key = HashedKey<Dependances<int, double>>::make({7, 0.5});
+        static_assert(key.hash() == std::hash<Dependances<int, double>>{}({7, 0.5}));
+
+        Cache<Dependances<int, double>, int, "Hashed"> cache;
+        cache.store(key, 1);
+        assert(cache.load(key) == 1 && cache.load({7, 0.5}) == 1);
+
+        int computed = 0;
+        [[maybe_unused]] auto compute = [&] { return ++computed; };
+        assert(cache.get_or_compute(key, compute) == 1 && computed == 0);
+        [[maybe_unused]] const bool cached = cache.load({8, 0.5}).has_value();
+        assert(cache.get_or_compute({8, 0.5}, compute) == 1 && cache.get_or_compute({8, 0.5}, compute) == 1);
+        assert(computed == (cached ? 0 : 1));
+
+        ConcurrentCache<Dependances<int, double>, int, "HashedConcurrent"> concurrent;
+        concurrent.store(key, 2);
+        assert(concurrent.get_or_compute(HashedKey<Dependances<int, double>>{{9, 0.5}}, [] { return 2; }) == 2);
+        concurrent.set_stores_availability(false);
+        assert(concurrent.load(key) == 2 && concurrent.load({9, 0.5}) == 2);
+
+        // Handles are hashed by their stored hash, plain keys always by std::hash
+        [[maybe_unused]] const HashedKey<Dependances<int, double>> announced{{7, 0.5}, 12345};
+        [[maybe_unused]] const KeyHash<Dependances<int, double>> hasher;
+        assert(hasher(announced) == 12345 && hasher(announced.get()) == key.hash());
+    }
+
+    { // Batched lookups
+        using Key = Dependances<int, double, char>;
+        std::vector<Key> keys;
+        for (int i = 0; i < 1000; i++)
+        {
+            keys.push_back({i, i * 0.5, static_cast<char>(i)});
+        }
+
+        std::vector<size_t> hashes(keys.size());
+        hash_keys(std::span<const Key>{keys}, std::span{hashes});
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            assert(hashes[i] == std::hash<Key>{}(keys[i]));
+        }
+
+        std::vector<std::byte> packed(16 * 37);
+        for (size_t i = 0; i < packed.size(); i++)
+        {
+            packed[i] = i % 16 < 13 ? static_cast<std::byte>(i * 7) : std::byte{0};
+        }
+        std::vector<uint64_t> scalar(37);
+        std::vector<uint64_t> vectorized(37);
+        simd::hash_packed_scalar(packed.data(), 16, 13, 37, scalar.data());
+        simd::best_hash_kernel()(packed.data(), 16, 13, 37, vectorized.data());
+        assert(scalar == vectorized);
+
+        Cache<Key, int, "Batched"> cache;
+        ConcurrentCache<Key, int, "BatchedConcurrent"> concurrent;
+        for (int i = 0; i < 1000; i += 2)
+        {
+            cache.store(keys[i], i);
+            concurrent.store(keys[i], i);
+        }
+        const auto values = cache.load_many(keys);
+        const auto concurrent_values = concurrent.load_many(keys);
+        for (int i = 0; i < 1000; i++)
+        {
+            assert(values[i] == (i % 2 ? std::nullopt : std::optional{i}) && concurrent_values[i] == values[i]);
+        }
+    }
+
+    { // Prefetching
+        StridePredictor<Dependances<int, double>> predictor;
+        assert(!predictor.observe({0, 0.0}) && !predictor.observe({2, 0.5}) && !predictor.observe({4, 1.0}));
+        assert(predictor.observe({6, 1.5}) && (predictor.predict(2) == Dependances<int, double>{10, 2.5}));
+        assert(!predictor.observe({7, 1.5}));
+
+        StridePredictor<Dependances<int, short>> extreme;
+        const int top = std::numeric_limits<int>::max();
+        const int low = std::numeric_limits<short>::min();
+        [[maybe_unused]] bool stable = false;
+        for (int i = 0; i < 4; i++)
+        {
+            stable = extreme.observe({top - 3 + i, static_cast<short>(low + 30000 * i)});
+        }
+        assert(stable);
+        [[maybe_unused]] const auto wrapped = extreme.predict(2);
+        assert((wrapped == Dependances<int, short>{std::numeric_limits<int>::min() + 1, static_cast<short>(low + 30000 * 5)}));
+
+        ConcurrentCache<Dependances<int, double>, int, "Prefetch"> cache;
+        cache.set_predictive_prefetch(4);
+        for (int i = 0; i < 100; i++)
+        {
+            cache.store({i, 0.0}, i);
+        }
+        for (int i = 0; i < 100; i++)
+        {
+            [[maybe_unused]] const auto key = cache.prefetch({i, 0.0});
+            assert(cache.load({i, 0.0}) == i && cache.load(key) == i);
+        }
+
+        StaticCache<Dependances<int>, int, 16, "PrefetchStatic"> static_cache;
+        static_cache.prefetch({1});
+    }
+
+    { // Latency histograms
+        LatencyHistogram histogram;
+        for (uint64_t value = 1; value <= 1000; value++)
+        {
+            histogram.record(value);
+        }
+        histogram.record(1'000'000);
+        assert(histogram.count() == 1001 && histogram.max() == 1'000'000);
+        assert(histogram.value_at_quantile(0.5) >= 500 && histogram.value_at_quantile(0.5) <= 500 * 33 / 32);
+        assert(histogram.value_at_quantile(1.0) == 1'000'000);
+        assert(LatencyHistogram::bucket_index(LatencyHistogram::bucket_upper_bound(700)) == 700);
+
+        ConcurrentCache<Dependances<int>, int, "Latency"> cache;
+        LatencyStats<"Latency">::set_sampling(1);
+        {
+            std::vector<std::jthread> threads;
+            for (int t = 0; t < 2; t++)
+            {
+                threads.emplace_back([&, t] {
+                    for (int i = 0; i < 100; i++)
+                    {
+                        cache.store({t * 100 + i}, i);
+                        assert(cache.load({t * 100 + i}) == i);
+                    }
+                });
+            }
+        }
+        [[maybe_unused]] const int existing = cache.get_or_compute({0}, [] { return -1; });
+        assert(existing == 0);
+        LatencyStats<"Latency">::set_sampling(0);
+        assert(cache.load({0}) == 0);
+
+        [[maybe_unused]] const auto loads = LatencyStats<"Latency">::report(Operation::Load);
+        assert(loads.count == 200 && loads.p50 <= loads.p99 && loads.p999 <= loads.max);
+        assert(LatencyStats<"Latency">::report(Operation::Store).count == 200);
+        assert(LatencyStats<"Latency">::report(Operation::GetOrCompute).count == 1);
+        // Exited threads are merged and unregistered, only the main thread owns histograms
+        assert(LatencyStats<"Latency">::recording_threads() == 1);
+        assert(LatencyStats<"Latency">::report(Operation::LockWait).count == 401);
+        LatencyStats<"Latency">::reset();
+        assert(LatencyStats<"Latency">::report(Operation::Load).count == 0);
+    }
+
+    { // Lock contention profiling
+        using namespace std::chrono_literals;
+        std::shared_mutex mtx;
+        LockProfiler profiler;
+        profiler.enable(true, {.long_hold = 0ns, .blocked_readers = 4});
+        {
+            auto writer = profiler.lock_exclusive(mtx, LockOperation::Store);
+            std::latch started{4};
+            std::vector<std::jthread> readers;
+            for (int i = 0; i < 4; i++)
+            {
+                readers.emplace_back([&] {
+                    started.count_down();
+                    auto lk = profiler.lock_shared(mtx, LockOperation::Load);
+                });
+            }
+            // Released only once every reader has found the lock taken
+            started.wait();
+            while (profiler.report().waiting < 4)
+            {
+                std::this_thread::yield();
+            }
+            auto release = std::move(writer);
+        }
+        const auto report = profiler.report();
+        assert(report.exclusive.acquisitions == 1 && report.shared.acquisitions == 4 && report.shared.contended == 4);
+        assert(report.by_holder[static_cast<size_t>(LockOperation::Store)].contended == 4 && report.waiting == 0);
+        assert(report.shared.max_wait_ns > 0 && report.shared.total_wait_ns >= report.shared.max_wait_ns);
+        assert(report.events.size() == 1 && report.events[0].kind == ContentionEvent::Kind::LongExclusiveHold);
+        assert(report.events[0].op == LockOperation::Store && report.events[0].blocked_readers == 4);
+
+        ConcurrentCache<Dependances<int>, int, "Contention"> cache;
+        cache.set_contention_profiling(true);
+        cache.store({1}, 1);
+        std::atomic<bool> iterating = false;
+        {
+            std::jthread writer{[&] {
+                while (!iterating)
+                {
+                    std::this_thread::yield();
+                }
+                cache.store({2}, 2);
+            }};
+            cache.for_each([&](const auto&, const auto&) {
+                iterating = true;
+                while (cache.contention_report().waiting == 0)
+                {
+                    std::this_thread::yield();
+                }
+            });
+        }
+        const auto cache_report = cache.contention_report();
+        assert(cache_report.exclusive.acquisitions == 2 && cache_report.exclusive.contended == 1);
+        assert(cache_report.behind_readers.contended == 1);
+        assert(cache_report.by_waiter[static_cast<size_t>(LockOperation::Store)].contended == 1);
+        cache.reset_contention();
+        assert(cache.contention_report().exclusive.acquisitions == 0);
+    }
+
+    { // Compression
+        std::vector<std::byte> data;
+        for (int i = 0; i < 5000; i++)
+        {
+            const auto bytes = Dependances<int, double>{i % 300, 0.5}.serialize();
+            data.insert(data.end(), bytes.begin(), bytes.end());
+        }
+        const auto compressed = compress(data);
+        assert(compressed.size() < data.size() / 4);
+        assert(decompress(compressed, data.size()) == data);
+        assert(!decompress(compressed, data.size() + 1));
+        assert(decompress(compress({}), 0) == std::vector<std::byte>{});
+
+        auto corrupted = compressed;
+        corrupted.resize(corrupted.size() / 2);
+        assert(!decompress(corrupted, data.size()));
+    }
+
+    { // Embedded dumps
+        using Key = Dependances<int, short>;
+        using EmbeddedCache = Cache<Key, double, "Embedded">;
+        static_assert(EmbeddedCache::embedded && !Cache<Key, double>::embedded);
+        {
+            EmbeddedCache cache;
+            assert(cache.size() == 3 && cache.load({2, 3}) == 2.5 && !cache.load({2, 4}));
+            assert(cache.load(HashedKey<Key>{{3, 4}}) == 3.5);
+            assert(cache.get_or_compute({1, 2}, [] { return 0.0; }) == 1.5);
+            cache.store({1, 2}, 10.0);
+            cache.store({5, 6}, 5.0);
+            assert(cache.load({1, 2}) == 10.0 && cache.size() == 4 && cache.entries().size() == 4);
+            double sum = 0;
+            cache.for_each([&](const Key&, double value) { sum += value; });
+            assert(sum == 10.0 + 2.5 + 3.5 + 5.0);
+        }
+        assert(!std::ifstream{EmbeddedCache::get_cache_file_name()});
+
+        ConcurrentCache<Key, double, "EmbeddedOverlay">{}.store({7, 8}, 7.0);
+        ConcurrentCache<Key, double, "EmbeddedOverlay"> overlay;
+        [[maybe_unused]] const size_t persisted = overlay.load({9, 9}) ? 5 : 4;
+        assert(overlay.load({7, 8}) == 7.0 && overlay.load({3, 4}) == 3.5 && overlay.size() == persisted);
+        [[maybe_unused]] const double computed = overlay.get_or_compute({9, 9}, [] { return 9.0; });
+        assert(computed == 9.0 && overlay.size() == 5);
+    }
+
+    { // Dump format
+        static_assert(type_fingerprint<Dependances<long>, int> == type_fingerprint<Dependances<long long>, int>);
+        static_assert(type_fingerprint<Dependances<int>, int> != type_fingerprint<Dependances<unsigned>, int>);
+        static_assert(type_fingerprint<Dependances<int, double>, int> != type_fingerprint<Dependances<double, int>, int>);
+        static_assert(type_fingerprint<Dependances<int>, Point> != type_fingerprint<Dependances<int>, long>);
+        static_assert(type_fingerprint<Dependances<int>, Point> != type_fingerprint<Dependances<int>, VersionedPoint>);
+        assert((dump_layout<Dependances<int, double>, Point>() == "i,d:bytes8"));
+
+        using DumpCache = Cache<Dependances<int>, double, "DumpFormat">;
+        const std::string file = DumpCache::get_cache_file_name();
+        std::remove(file.c_str());
+        {
+            DumpCache cache;
+            cache.store({1}, 1.5);
+            cache.store({2}, 2.5);
+        }
+        assert(DumpCache{}.load({2}) == 2.5);
+
+        {
+            // Same sizes written for other types
+            DumpWriter other{file, make_dump_header<Dependances<int>, double>(type_fingerprint<Dependances<unsigned>, double>),
+                             "j:d"};
+            other.write(Dependances<unsigned>{1}.serialize());
+            other.write(Caching::serialize(1.0));
+            [[maybe_unused]] const bool finished = other.finish(1);
+            assert(finished);
+        }
+        assert(DumpCache{}.size() == 0);
+
+        {
+            DumpCache cache;
+            cache.store({3}, 3.5);
+        }
+        {
+            std::fstream corrupt{file, std::ios::in | std::ios::out | std::ios::binary};
+            corrupt.seekp(-1, std::ios::end);
+            corrupt.put('\x7f');
+        }
+        assert(DumpCache{}.size() == 0);
+    }
+
+    { // Dump store
+        using StoredCache = Cache<Dependances<int>, int, "StoreA">;
+        using StoredStatic = StaticCache<Dependances<int>, double, 16, "StoreB">;
+        const std::string path = "_cache_store.bin";
+        std::remove(path.c_str());
+        {
+            DumpStore store{path};
+            StoredCache{}.store({1}, 10);
+            StoredStatic{}.store({2}, 2.5);
+            assert(store.namespaces().size() == 2 && !std::ifstream{StoredCache::get_cache_file_name()});
+            assert(StoredCache{}.load({1}) == 10);
+        }
+        assert(DumpStore::active() == nullptr && StoredCache{}.size() == 0);
+        {
+            DumpStore store{path};
+            StoredCache cache;
+            assert(cache.load({1}) == 10);
+            cache.store({3}, 30);
+        }
+        {
+            DumpStore store{path};
+            assert(StoredStatic{}.load({2}) == 2.5 && StoredCache{}.size() == 2);
+        }
+        std::remove(StoredCache::get_cache_file_name().c_str());
+    }
+
+    { // Dump byte order
+        constexpr std::array<DumpField, 4> fields{{{'i', 4}, {'d', 8}, {'c', 1}, {0, 4}}};
+        std::vector<std::byte> rows;
+        for (int i = 0; i < 3; i++)
+        {
+            const auto bytes = Dependances<int, double, char, std::array<char, 4>>{i + 0x01020304, i * 0.5, 'x', {'a', 'b', 'c', 'd'}}
+                                   .serialize();
+            rows.insert(rows.end(), bytes.begin(), bytes.end());
+        }
+        const auto original = rows;
+        swap_byte_order(rows, fields);
+        int swapped;
+        std::memcpy(&swapped, rows.data() + 17, sizeof(swapped));
+        assert(swapped == static_cast<int>(__builtin_bswap32(0x01020305)));
+        assert(std::memcmp(rows.data() + 17 + 12, "xabcd", 5) == 0);
+        swap_byte_order(rows, fields);
+        assert(rows == original);
+
+        dump_byte_order(rows, fields);
+        assert((rows == original) == (std::endian::native == std::endian::little));
+        static_assert([] {
+            std::array<std::byte, 2> bytes{std::byte{1}, std::byte{2}};
+            swap_byte_order(bytes, std::array{DumpField{'s', 2}});
+            return bytes[0] == std::byte{2};
+        }());
+
+        // Header fields are stored little-endian, a byte-swapped host copy restores the same header
+        DumpHeader header = make_dump_header<Dependances<int>, double>();
+        header.count = 0x0102030405060708;
+        header.layout_size = 5;
+        const auto stored = encode_fields(header);
+        assert(std::memcmp(stored.data(), "CDMP", 4) == 0 && stored[4] == std::byte{DumpVersion} && stored[7] == std::byte{0});
+        assert(stored[16] == std::byte{8} && stored[23] == std::byte{1});
+        auto big_endian = stored;
+        swap_byte_order(big_endian, DumpHeader::fields);
+        assert(std::memcmp(big_endian.data(), "CDMP", 4) == 0 && big_endian[7] == std::byte{DumpVersion});
+        swap_byte_order(big_endian, DumpHeader::fields);
+        [[maybe_unused]] const auto restored = decode_fields<DumpHeader>(big_endian);
+        assert(restored.matches(header) && restored.count == header.count && restored.layout_size == 5);
+
+        // Payload checksum does not depend on how writes are split and keeps its value
+        std::array<std::byte, 37> payload{};
+        for (size_t i = 0; i < payload.size(); i++)
+        {
+            payload[i] = static_cast<std::byte>(i * 29);
+        }
+        DumpChecksum whole;
+        DumpChecksum split;
+        whole.update(payload);
+        for (size_t offset = 0; offset < payload.size(); offset += 5)
+        {
+            split.update(std::span{payload}.subspan(offset, std::min<size_t>(5, payload.size() - offset)));
+        }
+        assert(whole.value() == split.value() && whole.value() == 0xd2da163bf49034eeull);
+    }
+
+    { // Aggregate serialization
+        static_assert(sizeof(Reading) == 24 && bin_size_v<Reading> == 11 && bin_size_v<Sample> == 19);
+        static_assert(Dependances<int, Reading>::BinSize == 15);
+        static_assert(Caching::serialize(Reading{'a', 1.0, 2})[9] == std::byte{2});
+
+        Reading padded;
+        std::memset(&padded, 0xff, sizeof(padded));
+        padded.sensor = 'a';
+        padded.value = 1.0;
+        padded.unit = 2;
+        const Dependances<int, Reading> key{1, padded};
+        assert((key == Dependances<int, Reading>{1, {'a', 1.0, 2}}));
+        assert((key != Dependances<int, Reading>{1, {'a', 1.0, 3}}));
+        assert((std::hash<Dependances<int, Reading>>{}(key) == std::hash<Dependances<int, Reading>>{}({1, {'a', 1.0, 2}})));
+
+        auto bytes = Caching::serialize(Sample{7, {'b', 2.5, 3}, {4, 5}});
+        [[maybe_unused]] const auto sample = Caching::deserialize<Sample>(std::span{bytes});
+        assert(sample.id == 7 && sample.reading.sensor == 'b' && sample.reading.value == 2.5 && sample.flags[1] == 5);
+
+        using AggregateCache = Cache<Dependances<int, Reading>, Sample, "Aggregates">;
+        std::remove(AggregateCache::get_cache_file_name().c_str());
+        AggregateCache{}.store(key, Sample{1, padded, {6, 7}});
+        [[maybe_unused]] const auto restored = AggregateCache{}.load({1, {'a', 1.0, 2}});
+        assert(restored && restored->reading.unit == 2 && restored->flags[0] == 6);
+        const std::string layout = dump_layout<Dependances<int, Reading>, Sample>();
+        assert(layout == "i,bytes11:bytes19");
+        std::ifstream dump{AggregateCache::get_cache_file_name(), std::ios::ate};
+        assert(dump.tellg() == static_cast<std::streamoff>(sizeof(DumpHeader) + layout.size() + 15 + 19));
+    }
+
+    { // Serialization plans
+        static_assert(serialization_plan<Extent>.size() == 1 && serialization_plan<Extent>[0].size == sizeof(Extent));
+        // value and unit are adjacent in both object and bytes
+        static_assert(serialization_plan<Reading>.size() == 2 && serialization_plan<Reading>[1].size == 10);
+        // id, nested sensor, nested value with unit, flags after tail padding of the nested member
+        static_assert(serialization_plan<Sample>.size() == 4 && serialization_plan<Sample>[3].object_offset == 32);
+        static_assert(bin_size_v<std::array<Reading, 2>> == 22 && serialization_plan<std::array<Reading, 2>>.size() == 4);
+
+        constexpr Sample sample{7, {'b', 2.5, 3}, {4, 5}};
+        [[maybe_unused]] constexpr auto expected = Caching::serialize(sample);
+        assert(Caching::serialize(sample) == expected);
+        std::array<std::byte, bin_size_v<Sample>> written{};
+        serialize_to(sample, written.data());
+        assert(written == expected);
+
+        const std::vector<Reading> readings{{'a', 1.0, 2}, {'b', 2.0, 3}, {'c', 3.0, 4}};
+        std::vector<std::byte> rows(readings.size() * bin_size_v<Reading>);
+        serialize_n(std::span{readings}, rows.data());
+        assert(std::equal(rows.begin() + 11, rows.begin() + 22, Caching::serialize(readings[1]).begin()));
+        std::vector<Reading> restored(readings.size());
+        deserialize_n(rows.data(), std::span{restored});
+        assert(restored[2].sensor == 'c' && restored[2].value == 3.0 && restored[2].unit == 4);
+
+        const std::vector<Extent> extents{{1, 2, 0.5f}, {3, 4, 1.5f}};
+        std::vector<std::byte> dense(extents.size() * sizeof(Extent));
+        serialize_n(std::span{extents}, dense.data());
+        std::vector<Extent> extents_back(2);
+        deserialize_n(dense.data(), std::span{extents_back});
+        assert(extents_back[1].height == 4 && extents_back[1].scale == 1.5f);
+
+        const std::array<Reading, 2> pair{{{'x', 1.0, 1}, {'y', 2.0, 2}}};
+        auto pair_bytes = Caching::serialize(pair);
+        [[maybe_unused]] const auto pair_back = Caching::deserialize<std::array<Reading, 2>>(std::span{pair_bytes});
+        assert(pair_back[1].sensor == 'y' && pair_back[1].unit == 2);
+    }
 }
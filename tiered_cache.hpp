@@ -0,0 +1,398 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "serialization.hpp"
+#include "compression.hpp"
+#include "helpers.hpp"
+#include "persistence.hpp"
+#include "probes.hpp"
+
+namespace Caching {
+
+/**
+ * TieredCache class
+ *
+ * Implements caching with a compressed in-memory cold tier
+ * Entries not accessed during the idle limit are serialized into blocks of BlockRecords values
+ * compressed by lz, the table keeps a compact reference to the value in its block. A load of
+ * a cold entry decompresses its block and promotes the entry back to the hot tier.
+ * A block is released when its last entry is promoted or overwritten
+ * Entries restored from the dump file start cold, hottest first by persisted access counters
+ * so that they share blocks
+ * Uses the same dump file format as Cache with identical types and Tag
+ *
+ * @tparam Key type of a key
+ * @tparam Value type of cached values
+ * @tparam Tag file tag string for identificaion
+ */
+template <typename Key, typename Value, StringLiteral Tag = "">
+class TieredCache
+{
+public:
+    /// Values compressed together, more records compress better but cost more per promotion
+    static constexpr size_t BlockRecords = 64;
+
+    TieredCache() : TieredCache(LoadBudget{}) {}
+
+    /// @param budget limits of restoring the dump file
+    explicit TieredCache(const LoadBudget& budget)
+    {
+        load_from_file(budget);
+    }
+
+    ~TieredCache()
+    {
+        dump_to_file();
+    }
+
+    /// @brief Getter for file name for cache dump
+    /// @return name of an associated file
+    static const std::string& get_cache_file_name()
+    {
+        static const std::string file_name = Caching::cache_file_name<Key, Value, Tag>();
+        return file_name;
+    }
+
+    /// @brief Obtaines value by provided key if present, a cold entry is promoted to the hot tier
+    /// @param key key for value
+    /// @return std::optional for value
+    [[nodiscard]] std::optional<Value> load(const Key& key)
+    {
+        tick();
+        if (auto it = hot.find(key); it != hot.end())
+        {
+            it->second.accessed = clock;
+            it->second.frequency += it->second.frequency != UINT32_MAX;
+            return it->second.value;
+        }
+        auto it = cold.find(key);
+        if (it == cold.end())
+        {
+            return std::nullopt;
+        }
+        Value value = cold_value(it->second);
+        const uint32_t frequency = it->second.frequency + (it->second.frequency != UINT16_MAX);
+        release(it->second);
+        cold.erase(it);
+        hot.try_emplace(key, HotEntry{value, clock, frequency});
+        return value;
+    }
+
+    /// @brief Saves value to the hot tier
+    /// @tparam V type for value. Required for perfect forwarding
+    /// @param deps key for storing value
+    /// @param value value to store at key
+    template <typename V>
+    void store(const Key& deps, V&& value)
+    {
+        tick();
+        if (auto it = cold.find(deps); it != cold.end())
+        {
+            release(it->second);
+            cold.erase(it);
+        }
+        hot.insert_or_assign(deps, HotEntry{std::forward<V>(value), clock});
+    }
+
+    /// @brief Sets number of accesses after which an untouched entry moves to the cold tier
+    /// Hot entries are swept once per idle limit accesses
+    /// @param accesses idle limit, 0 keeps all entries hot until demote_idle is called
+    void set_idle_limit(uint64_t accesses)
+    {
+        idle_limit = accesses;
+    }
+
+    /// @brief Compresses entries not accessed during the idle limit into cold blocks
+    /// @param accesses idle limit for this sweep
+    /// @return number of demoted entries
+    size_t demote_idle(uint64_t accesses)
+    {
+        std::vector<typename decltype(hot)::iterator> idle;
+        for (auto it = hot.begin(); it != hot.end(); ++it)
+        {
+            if (clock - it->second.accessed >= accesses)
+            {
+                idle.push_back(it);
+            }
+        }
+        for (size_t first = 0; first < idle.size(); first += BlockRecords)
+        {
+            const size_t records = std::min(BlockRecords, idle.size() - first);
+            std::vector<std::byte> raw(records * bin_size_v<Value>);
+            for (size_t i = 0; i < records; i++)
+            {
+                Caching::serialize_to(idle[first + i]->second.value, raw.data() + i * bin_size_v<Value>);
+            }
+            const uint32_t block = add_block(raw, records);
+            for (size_t i = 0; i < records; i++)
+            {
+                const HotEntry& entry = idle[first + i]->second;
+                const auto frequency = static_cast<uint16_t>(std::min<uint32_t>(entry.frequency, UINT16_MAX));
+                cold.try_emplace(idle[first + i]->first,
+                                 ColdRef{block, static_cast<uint16_t>(i), frequency, static_cast<uint32_t>(entry.accessed)});
+                hot.erase(idle[first + i]);
+            }
+        }
+        return idle.size();
+    }
+
+    /// @brief Number of cached entries
+    [[nodiscard]] size_t size() const
+    {
+        return hot.size() + cold.size();
+    }
+
+    /// @brief Number of entries in the hot tier
+    [[nodiscard]] size_t hot_size() const
+    {
+        return hot.size();
+    }
+
+    /// @brief Number of entries in the cold tier
+    [[nodiscard]] size_t cold_size() const
+    {
+        return cold.size();
+    }
+
+    /// @brief Memory held by cold blocks
+    [[nodiscard]] size_t cold_bytes() const
+    {
+        size_t bytes = 0;
+        for (const ColdBlock& block : blocks)
+        {
+            bytes += block.bytes.capacity();
+        }
+        return bytes;
+    }
+
+    /// @brief Invokes function for every cached entry without promoting cold ones
+    /// @param fn callable accepting (const Key&, const Value&)
+    template <typename F>
+    void for_each(F&& fn) const
+    {
+        for_each_entry([&](const Key& key, const Value& value, const AccessStats&) { std::invoke(fn, key, value); });
+    }
+
+protected:
+    struct HotEntry
+    {
+        Value value;
+        /// Clock at the last access
+        uint64_t accessed = 0;
+        /// Accesses, saturating
+        uint32_t frequency = 0;
+    };
+
+    /// Location of a cold value with its access counters
+    struct ColdRef
+    {
+        uint32_t block = 0;
+        uint16_t index = 0;
+        uint16_t frequency = 0;
+        /// Low bits of clock at the last access
+        uint32_t accessed = 0;
+    };
+
+    template <typename F>
+    void for_each_entry(F&& fn) const
+    {
+        for (const auto& [key, entry] : hot)
+        {
+            std::invoke(fn, key, entry.value, AccessStats{entry.frequency, idle_since(entry.accessed)});
+        }
+        // Cold entries grouped by block so each block is decompressed once
+        std::vector<std::pair<ColdRef, const Key*>> refs;
+        refs.reserve(cold.size());
+        for (const auto& [key, ref] : cold)
+        {
+            refs.emplace_back(ref, &key);
+        }
+        std::ranges::sort(refs, {}, [](const auto& ref) { return ref.first.block; });
+        std::vector<Value> values;
+        uint32_t current = UINT32_MAX;
+        for (const auto& [ref, key] : refs)
+        {
+            if (ref.block != current)
+            {
+                current = ref.block;
+                const auto raw = unpack(blocks[current]);
+                values.resize(blocks[current].records);
+                Caching::deserialize_n(raw.data(), std::span{values});
+            }
+            std::invoke(fn, *key, values[ref.index], AccessStats{ref.frequency, idle_since(ref.accessed)});
+        }
+    }
+
+    /// @brief Accesses of the cache since given clock, computed on the low bits kept by cold entries
+    uint32_t idle_since(uint64_t accessed) const
+    {
+        return static_cast<uint32_t>(clock) - static_cast<uint32_t>(accessed);
+    }
+
+    struct ColdBlock
+    {
+        /// lz block, or raw values when compression does not shrink them
+        std::vector<std::byte> bytes;
+        uint32_t records = 0;
+        uint32_t live = 0;
+        bool compressed = false;
+    };
+
+    /// @brief Advances access clock, sweeping hot entries once per idle limit
+    void tick()
+    {
+        clock++;
+        if (idle_limit != 0 && clock % idle_limit == 0)
+        {
+            demote_idle(idle_limit);
+        }
+    }
+
+    /// @brief Stores serialized values as a new block, reusing a released one
+    uint32_t add_block(std::span<const std::byte> raw, size_t records)
+    {
+        ColdBlock block;
+        block.bytes = Caching::compress(raw);
+        block.compressed = block.bytes.size() < raw.size();
+        if (!block.compressed)
+        {
+            block.bytes.assign(raw.begin(), raw.end());
+        }
+        block.bytes.shrink_to_fit();
+        block.records = static_cast<uint32_t>(records);
+        block.live = block.records;
+        if (!free_blocks.empty())
+        {
+            const uint32_t index = free_blocks.back();
+            free_blocks.pop_back();
+            blocks[index] = std::move(block);
+            return index;
+        }
+        blocks.push_back(std::move(block));
+        return static_cast<uint32_t>(blocks.size() - 1);
+    }
+
+    /// @brief Serialized values of a block
+    static std::vector<std::byte> unpack(const ColdBlock& block)
+    {
+        if (!block.compressed)
+        {
+            return block.bytes;
+        }
+        // Blocks are produced in memory by compress, a failure is a corrupted heap
+        auto raw = Caching::decompress(block.bytes, block.records * bin_size_v<Value>);
+        if (!raw)
+        {
+            throw std::runtime_error("TieredCache: corrupted cold block");
+        }
+        return std::move(*raw);
+    }
+
+    Value cold_value(const ColdRef& ref) const
+    {
+        auto raw = unpack(blocks[ref.block]);
+        return Caching::deserialize<Value>(
+            std::span<std::byte, bin_size_v<Value>>{raw.data() + ref.index * bin_size_v<Value>, bin_size_v<Value>});
+    }
+
+    /// @brief Drops reference to a cold value, releasing its block with the last one
+    void release(const ColdRef& ref)
+    {
+        ColdBlock& block = blocks[ref.block];
+        if (--block.live == 0)
+        {
+            block = ColdBlock{};
+            free_blocks.push_back(ref.block);
+        }
+    }
+
+    /// @brief Restores data from an associated file into the cold tier
+    void load_from_file(const LoadBudget& budget)
+    {
+        static constexpr size_t key_val_size = Key::BinSize + bin_size_v<Value>;
+
+        auto payload = Caching::read_records<Key, Value>(get_cache_file_name());
+        if (!payload)
+        {
+            return;
+        }
+        CACHING_PROBE(file_load_begin, Tag.value);
+        const auto start = std::chrono::steady_clock::now();
+        const auto order = payload->hotness_order();
+        const size_t entries = budget.entries(order.size(), sizeof(Key) + sizeof(ColdRef) + bin_size_v<Value>);
+        std::vector<std::byte> raw;
+        raw.reserve(BlockRecords * bin_size_v<Value>);
+        for (size_t first = 0; first < entries; first += BlockRecords)
+        {
+            if (std::chrono::steady_clock::now() - start > budget.max_duration)
+            {
+                break;
+            }
+            const size_t records = std::min(BlockRecords, entries - first);
+            raw.clear();
+            for (size_t i = 0; i < records; i++)
+            {
+                const std::byte* record = payload->bytes.data() + order[first + i] * key_val_size;
+                raw.insert(raw.end(), record + Key::BinSize, record + key_val_size);
+            }
+            const uint32_t block = add_block(raw, records);
+            for (size_t i = 0; i < records; i++)
+            {
+                std::byte* record = payload->bytes.data() + order[first + i] * key_val_size;
+                ColdRef ref{block, static_cast<uint16_t>(i)};
+                if (!payload->stats.empty())
+                {
+                    const AccessStats& stats = payload->stats[order[first + i]];
+                    ref.frequency = static_cast<uint16_t>(std::min<uint32_t>(stats.frequency, UINT16_MAX));
+                    // Clock starts at 0, so the last access lies idle accesses before it
+                    ref.accessed = 0u - stats.idle;
+                }
+                cold.try_emplace(Caching::deserialize<Key>(std::span<std::byte, Key::BinSize>{record, Key::BinSize}), ref);
+            }
+        }
+        CACHING_PROBE(file_load_end, Tag.value, size(), payload->bytes.size());
+    }
+
+    /// @brief Dumps entries of both tiers to an associated file
+    void dump_to_file() const
+    {
+        static constexpr size_t key_val_size = Key::BinSize + bin_size_v<Value>;
+
+        CACHING_PROBE(dump_begin, Tag.value, size());
+        std::vector<std::byte> rows(size() * key_val_size);
+        std::vector<AccessStats> stats;
+        stats.reserve(size());
+        std::byte* record = rows.data();
+        for_each_entry([&](const Key& key, const Value& value, const AccessStats& access) {
+            Caching::serialize_to(key, record);
+            Caching::serialize_to(value, record + Key::BinSize);
+            record += key_val_size;
+            stats.push_back(access);
+        });
+        auto file_dump = Caching::write_records<Key, Value>(get_cache_file_name());
+        file_dump.write_rows(rows, record_fields<Key, Value>());
+        file_dump.write_access_stats(stats);
+        file_dump.finish(size());
+        CACHING_PROBE(dump_end, Tag.value, rows.size());
+    }
+
+    std::unordered_map<Key, HotEntry> hot;
+    std::unordered_map<Key, ColdRef> cold;
+    std::vector<ColdBlock> blocks;
+    std::vector<uint32_t> free_blocks;
+    uint64_t clock = 0;
+    uint64_t idle_limit = 0;
+};
+
+}  // namespace Caching
@@ -0,0 +1,1158 @@
+// cache-tool: inspection, validation, conversion and load benchmark of cache dump files
+//
+//   cache-tool info FILE                       entry counts, sizes, per-field histograms, hash quality
+//   cache-tool validate FILE                   structural checks, checksum of converted files
+//   cache-tool COMMAND STORE --namespace NAME  runs a command on one dump of a DumpStore file
+//   cache-tool convert FILE OUT --to FORMAT    FORMAT is row, sorted, columnar, compressed or raw
+//   cache-tool bench FILE [--reps N] [--cold]  times reading and indexing the file like Cache startup
+//   cache-tool embed FILE OUT.hpp --tag TAG [--overlay]
+//                                              generates embedded_dump<TAG> table compiled into the binary
+//
+// Record layout and type fingerprint are read from the dump header. Headerless dumps of earlier
+// versions (format raw) are described by their file name listing typeid names of key components
+// and value, or explicitly with --layout KEY:VALUE, e.g. --layout i,d:f or --layout bytes16:d
+// row is the format caches read, sorted is row ordered by key, columnar and compressed are tool
+// containers carrying layout, fingerprint and checksum that convert back to row, raw writes a
+// headerless row dump. Access counters appended by some caches are reported by info and not
+// carried over by convert. Dumps of InternedCache are expanded to rows for info, validate and
+// bench but are not converted nor embedded, their fingerprint only matches InternedCache
+// info and validate of a DumpStore file without --namespace cover all its namespaces
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "compression.hpp"
+#include "helpers.hpp"
+#include "persistence.hpp"
+
+namespace {
+
+using Bytes = std::vector<std::byte>;
+
+/// Field of a record, arithmetic fields are described by their type code
+using Field = Caching::DumpField;
+
+struct Layout
+{
+    std::vector<Field> key;
+    Field value;
+
+    size_t key_size() const
+    {
+        return std::accumulate(key.begin(), key.end(), size_t{0}, [](size_t sum, const Field& f) { return sum + f.size; });
+    }
+
+    size_t record_size() const
+    {
+        return key_size() + value.size;
+    }
+
+    /// Fingerprint of types with this layout and no schema versions
+    uint64_t fingerprint() const
+    {
+        return Caching::layout_fingerprint(key, value);
+    }
+
+    std::string to_string() const;
+};
+
+struct TypeCode
+{
+    char code;
+    size_t size;
+    const char* name;
+};
+
+constexpr TypeCode type_codes[] = {
+    {'b', sizeof(bool), "bool"},           {'c', sizeof(char), "char"},
+    {'a', sizeof(signed char), "schar"},   {'h', sizeof(unsigned char), "uchar"},
+    {'s', sizeof(short), "short"},         {'t', sizeof(unsigned short), "ushort"},
+    {'i', sizeof(int), "int"},             {'j', sizeof(unsigned), "unsigned"},
+    {'l', sizeof(long), "long"},           {'m', sizeof(unsigned long), "ulong"},
+    {'x', sizeof(long long), "llong"},     {'y', sizeof(unsigned long long), "ullong"},
+    {'f', sizeof(float), "float"},         {'d', sizeof(double), "double"},
+};
+
+std::optional<Field> parse_field(std::string_view text)
+{
+    for (const TypeCode& type : type_codes)
+    {
+        if (text == std::string_view{&type.code, 1} || text == type.name)
+        {
+            return Field{type.code, type.size};
+        }
+    }
+    if (text.starts_with("bytes"))
+    {
+        const size_t size = std::strtoul(std::string{text.substr(5)}.c_str(), nullptr, 10);
+        if (size > 0)
+        {
+            return Field{0, size};
+        }
+    }
+    return std::nullopt;
+}
+
+std::string type_name(const Field& field)
+{
+    for (const TypeCode& type : type_codes)
+    {
+        if (type.code == field.code)
+        {
+            return type.name;
+        }
+    }
+    return "bytes" + std::to_string(field.size);
+}
+
+std::string Layout::to_string() const
+{
+    std::string res;
+    for (const Field& field : key)
+    {
+        res += (res.empty() ? "" : ",") + Caching::field_name(field);
+    }
+    return res + ":" + Caching::field_name(value);
+}
+
+/// @brief Parses KEY:VALUE layout, key fields separated by commas
+std::optional<Layout> parse_layout(std::string_view text)
+{
+    const size_t colon = text.find(':');
+    if (colon == std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+    Layout layout;
+    std::string_view keys = text.substr(0, colon);
+    while (!keys.empty())
+    {
+        const size_t comma = std::min(keys.find(','), keys.size());
+        const auto field = parse_field(keys.substr(0, comma));
+        if (!field)
+        {
+            return std::nullopt;
+        }
+        layout.key.push_back(*field);
+        keys.remove_prefix(std::min(comma + 1, keys.size()));
+    }
+    const auto value = parse_field(text.substr(colon + 1));
+    if (layout.key.empty() || !value)
+    {
+        return std::nullopt;
+    }
+    layout.value = *value;
+    return layout;
+}
+
+/// @brief Derives layout from file name of a headerless dump
+/// "_cache_<key typeids separated by _>__<value typeid>[_<Tag>][_<kind>].bin"
+std::optional<Layout> layout_from_file_name(std::string_view path)
+{
+    std::string_view name = path.substr(path.find_last_of('/') + 1);
+    if (!name.starts_with("_cache_"))
+    {
+        return std::nullopt;
+    }
+    name.remove_prefix(7);
+    const size_t split = name.find("__");
+    if (split == std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+    std::string spec{name.substr(0, split)};
+    std::ranges::replace(spec, '_', ',');
+    const std::string_view rest = name.substr(split + 2);
+    return parse_layout(spec + ":" + std::string{rest.substr(0, std::min(rest.find_first_of("_."), rest.size()))});
+}
+
+/// Converted files start with this header followed by the layout string and payload
+struct ContainerHeader
+{
+    char magic[4] = {'C', 'T', 'L', '2'};
+    uint32_t format = 0;
+    uint64_t records = 0;
+    uint64_t payload_size = 0;
+    uint64_t row_size = 0;
+    uint64_t checksum = 0;
+    uint64_t fingerprint = 0;
+    uint32_t layout_size = 0;
+    uint32_t reserved = 0;
+
+    static constexpr std::array<Field, 9> fields = {Field{0, 4},   Field{'j', 4}, Field{'y', 8}, Field{'y', 8}, Field{'y', 8},
+                                                    Field{'y', 8}, Field{'y', 8}, Field{'j', 4}, Field{'j', 4}};
+};
+
+enum Format : uint32_t
+{
+    Row,
+    Sorted,
+    Columnar,
+    Compressed,
+    Raw,
+    Interned,
+};
+
+constexpr const char* format_names[] = {"row", "sorted", "columnar", "compressed", "raw", "interned"};
+
+/// Dump contents decoded to row records
+struct Dump
+{
+    Layout layout;
+    Format format = Row;
+    uint64_t fingerprint = 0;
+    Bytes rows;
+    /// Whether records are followed by persisted access counters
+    bool access_stats = false;
+    /// Size of values table of interned dumps
+    size_t distinct_values = 0;
+    size_t file_size = 0;
+    std::string problem;  // set when the file is inconsistent
+};
+
+Bytes read_file(const std::string& path)
+{
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+    if (!file)
+    {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        std::exit(2);
+    }
+    Bytes data(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    return data;
+}
+
+void write_file(const std::string& path, std::span<const std::byte> data)
+{
+    std::ofstream file{path, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!file)
+    {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        std::exit(2);
+    }
+}
+
+Bytes rows_from_columns(std::span<const std::byte> columns, const Layout& layout, size_t records)
+{
+    Bytes rows(records * layout.record_size());
+    size_t column_offset = 0;
+    size_t field_offset = 0;
+    auto gather = [&](const Field& field) {
+        for (size_t r = 0; r < records; r++)
+        {
+            std::memcpy(rows.data() + r * layout.record_size() + field_offset, columns.data() + column_offset + r * field.size,
+                        field.size);
+        }
+        column_offset += records * field.size;
+        field_offset += field.size;
+    };
+    std::ranges::for_each(layout.key, gather);
+    gather(layout.value);
+    return rows;
+}
+
+Bytes columns_from_rows(std::span<const std::byte> rows, const Layout& layout)
+{
+    const size_t records = rows.size() / layout.record_size();
+    Bytes columns(rows.size());
+    size_t column_offset = 0;
+    size_t field_offset = 0;
+    auto scatter = [&](const Field& field) {
+        for (size_t r = 0; r < records; r++)
+        {
+            std::memcpy(columns.data() + column_offset + r * field.size, rows.data() + r * layout.record_size() + field_offset,
+                        field.size);
+        }
+        column_offset += records * field.size;
+        field_offset += field.size;
+    };
+    std::ranges::for_each(layout.key, scatter);
+    scatter(layout.value);
+    return columns;
+}
+
+/// @brief Expands payload of an InternedCache dump, a values table followed by (key, value index)
+/// records, to rows
+/// @return false when payload does not have that shape
+bool decode_interned(std::span<const std::byte> payload, size_t records, Dump& dump)
+{
+    const size_t key_size = dump.layout.key_size();
+    const size_t value_size = dump.layout.value.size;
+    const size_t index_size = key_size + sizeof(uint64_t);
+    uint64_t value_count = 0;
+    if (payload.size() < sizeof(value_count) || (payload.size() - sizeof(value_count)) / index_size < records)
+    {
+        return false;
+    }
+    std::memcpy(&value_count, payload.data(), sizeof(value_count));
+    const size_t table_size = payload.size() - sizeof(value_count) - records * index_size;
+    if (table_size % value_size != 0 || table_size / value_size != value_count)
+    {
+        return false;
+    }
+
+    dump.format = Interned;
+    dump.distinct_values = value_count;
+    const std::byte* table = payload.data() + sizeof(value_count);
+    const std::byte* record = table + table_size;
+    dump.rows.resize(records * dump.layout.record_size());
+    for (size_t r = 0; r < records; r++, record += index_size)
+    {
+        uint64_t index = 0;
+        std::memcpy(&index, record + key_size, sizeof(index));
+        if (index >= value_count)
+        {
+            dump.problem = "value index out of range in record " + std::to_string(r);
+            dump.rows.resize(r * dump.layout.record_size());
+            break;
+        }
+        std::byte* row = dump.rows.data() + r * dump.layout.record_size();
+        std::memcpy(row, record, key_size);
+        std::memcpy(row + key_size, table + index * value_size, value_size);
+    }
+    return true;
+}
+
+/// @brief Decodes dump written by a cache, checking header against layout and payload
+Dump decode_row_dump(const Bytes& data)
+{
+    Dump dump;
+    dump.file_size = data.size();
+
+    const auto header = Caching::decode_fields<Caching::DumpHeader>(std::span{data}.first<sizeof(Caching::DumpHeader)>());
+    const size_t payload_offset = sizeof(header) + header.layout_size;
+    const auto layout = parse_layout({reinterpret_cast<const char*>(data.data() + sizeof(header)),
+                                      std::min<size_t>(header.layout_size, data.size() - sizeof(header))});
+    if (header.version != Caching::DumpVersion || !layout || payload_offset + header.payload_size != data.size())
+    {
+        dump.problem = "corrupted dump header";
+        return dump;
+    }
+    dump.layout = *layout;
+    dump.fingerprint = header.fingerprint;
+    dump.access_stats = header.flags & Caching::DumpAccessStats;
+    const size_t records_size = header.count * dump.layout.record_size();
+    const size_t stats_size = dump.access_stats ? header.count * sizeof(Caching::AccessStats) : 0;
+    if (header.key_size != dump.layout.key_size() || header.value_size != dump.layout.value.size)
+    {
+        dump.problem = "payload does not match layout, not a dump of (key, value) records";
+        return dump;
+    }
+    const std::span<const std::byte> payload{data.data() + payload_offset, header.payload_size};
+    Caching::DumpChecksum checksum;
+    checksum.update(payload);
+    if (checksum.value() != header.checksum)
+    {
+        dump.problem = "checksum mismatch";
+        return dump;
+    }
+    if (header.payload_size == records_size + stats_size)
+    {
+        dump.rows.assign(payload.begin(), payload.begin() + records_size);
+    }
+    else if (dump.access_stats || !decode_interned(payload, header.count, dump))
+    {
+        dump.problem = "payload does not match layout, not a dump of (key, value) records";
+    }
+    return dump;
+}
+
+/// @brief Decodes dump image of a cache, rejecting images of other formats
+Dump decode_image(const Bytes& data)
+{
+    if (data.size() >= sizeof(Caching::DumpHeader)
+        && std::memcmp(data.data(), Caching::DumpMagic.data(), Caching::DumpMagic.size()) == 0)
+    {
+        return decode_row_dump(data);
+    }
+    Dump dump;
+    dump.file_size = data.size();
+    dump.problem = "not a dump image";
+    return dump;
+}
+
+using StoreHeader = Caching::DumpStore::StoreHeader;
+using DirectoryEntry = Caching::DumpStore::DirectoryEntry;
+
+/// Namespace of a DumpStore file with its decoded dump
+struct StoreNamespace
+{
+    std::string name;
+    uint64_t fingerprint = 0;
+    Dump dump;
+};
+
+/// DumpStore file contents
+struct Store
+{
+    std::vector<StoreNamespace> namespaces;
+    size_t file_size = 0;
+    std::string problem;  // set when the directory is inconsistent
+};
+
+bool is_store(const Bytes& data)
+{
+    return data.size() >= sizeof(StoreHeader) && std::memcmp(data.data(), StoreHeader{}.magic.data(), 4) == 0;
+}
+
+/// @brief Decodes directory of a DumpStore file and dumps of its namespaces
+Store decode_store(const Bytes& data)
+{
+    Store store;
+    store.file_size = data.size();
+    const auto header = Caching::decode_fields<StoreHeader>(std::span{data}.first<sizeof(StoreHeader)>());
+    if (header.version != Caching::DumpVersion)
+    {
+        store.problem = "unsupported store version " + std::to_string(header.version);
+        return store;
+    }
+    size_t offset = sizeof(header);
+    for (uint32_t i = 0; i < header.namespaces; i++)
+    {
+        if (data.size() - offset < sizeof(DirectoryEntry))
+        {
+            store.problem = "truncated store directory";
+            return store;
+        }
+        const auto entry = Caching::decode_fields<DirectoryEntry>(std::span{data}.subspan(offset).first<sizeof(DirectoryEntry)>());
+        offset += sizeof(entry);
+        if (data.size() - offset < entry.name_size || entry.offset > data.size() || data.size() - entry.offset < entry.size)
+        {
+            store.problem = "namespace " + std::to_string(i) + " lies outside of the store file";
+            return store;
+        }
+        StoreNamespace& space = store.namespaces.emplace_back();
+        space.name.assign(reinterpret_cast<const char*>(data.data() + offset), entry.name_size);
+        space.fingerprint = entry.fingerprint;
+        space.dump = decode_image(Bytes(data.begin() + static_cast<ptrdiff_t>(entry.offset),
+                                        data.begin() + static_cast<ptrdiff_t>(entry.offset + entry.size)));
+        if (space.dump.problem.empty() && space.dump.fingerprint != space.fingerprint)
+        {
+            space.dump.problem = "fingerprint does not match store directory";
+        }
+        offset += entry.name_size;
+    }
+    return store;
+}
+
+/// @brief Decodes file contents, path is used to derive layout of headerless dumps
+/// @param space namespace selecting a dump of a DumpStore file
+Dump decode_dump(Bytes data, std::string_view path, const std::optional<Layout>& layout_override,
+                 const std::optional<std::string_view>& space)
+{
+    if (is_store(data) != space.has_value())
+    {
+        std::fprintf(stderr, space ? "--namespace applies to DumpStore files only\n"
+                                   : "file is a DumpStore, select a dump with --namespace NAME, info lists them\n");
+        std::exit(2);
+    }
+    if (space)
+    {
+        Store store = decode_store(data);
+        const auto it = std::ranges::find(store.namespaces, *space, &StoreNamespace::name);
+        if (it == store.namespaces.end())
+        {
+            std::fprintf(stderr, "no namespace %.*s in store%s%s\n", static_cast<int>(space->size()), space->data(),
+                         store.problem.empty() ? "" : ": ", store.problem.c_str());
+            std::exit(2);
+        }
+        return std::move(it->dump);
+    }
+    if (data.size() >= sizeof(Caching::DumpHeader)
+        && std::memcmp(data.data(), Caching::DumpMagic.data(), Caching::DumpMagic.size()) == 0)
+    {
+        return decode_row_dump(data);
+    }
+
+    Dump dump;
+    dump.file_size = data.size();
+
+    ContainerHeader header;
+    if (data.size() >= sizeof(header) && std::memcmp(data.data(), header.magic, sizeof(header.magic)) == 0)
+    {
+        header = Caching::decode_fields<ContainerHeader>(std::span{data}.first<sizeof(ContainerHeader)>());
+        const size_t payload_offset = sizeof(header) + header.layout_size;
+        const auto layout = parse_layout({reinterpret_cast<const char*>(data.data() + sizeof(header)),
+                                          std::min<size_t>(header.layout_size, data.size() - sizeof(header))});
+        if (!layout || header.format > Compressed || payload_offset + header.payload_size != data.size())
+        {
+            dump.problem = "corrupted container header";
+            return dump;
+        }
+        dump.layout = *layout;
+        dump.format = static_cast<Format>(header.format);
+        dump.fingerprint = header.fingerprint;
+        const std::span<const std::byte> payload{data.data() + payload_offset, header.payload_size};
+        if (Caching::hash_bytes(payload) != header.checksum)
+        {
+            dump.problem = "checksum mismatch";
+            return dump;
+        }
+        if (header.row_size != header.records * dump.layout.record_size())
+        {
+            dump.problem = "record count does not match layout";
+            return dump;
+        }
+        if (dump.format == Compressed)
+        {
+            auto rows = Caching::decompress(payload, header.row_size);
+            if (!rows)
+            {
+                dump.problem = "corrupted compressed payload";
+                return dump;
+            }
+            dump.rows = std::move(*rows);
+        }
+        else if (dump.format == Columnar && header.payload_size == header.row_size)
+        {
+            dump.rows = rows_from_columns(payload, dump.layout, header.records);
+        }
+        else
+        {
+            dump.problem = "payload size does not match format";
+        }
+        return dump;
+    }
+
+    const auto layout = layout_override ? layout_override : layout_from_file_name(path);
+    if (!layout)
+    {
+        std::fprintf(stderr, "cannot derive record layout from file name, pass --layout KEY:VALUE\n");
+        std::exit(2);
+    }
+    dump.layout = *layout;
+    dump.format = Raw;
+    dump.fingerprint = dump.layout.fingerprint();
+    if (data.size() % dump.layout.record_size() != 0)
+    {
+        dump.problem = "file size " + std::to_string(data.size()) + " is not a multiple of record size "
+                     + std::to_string(dump.layout.record_size());
+        data.resize(data.size() - data.size() % dump.layout.record_size());
+    }
+    dump.rows = std::move(data);
+    return dump;
+}
+
+Dump load_dump(const std::string& path, const std::optional<Layout>& layout_override,
+               const std::optional<std::string_view>& space)
+{
+    return decode_dump(read_file(path), path, layout_override, space);
+}
+
+/// @brief Decodes little-endian arithmetic field to double for statistics
+double field_value(const std::byte* ptr, const Field& field)
+{
+    auto read = [&]<typename T>(T) {
+        std::array<std::byte, sizeof(T)> bytes;
+        std::memcpy(bytes.data(), ptr, sizeof(T));
+        Caching::dump_byte_order(bytes, std::array{field});
+        return static_cast<double>(std::bit_cast<T>(bytes));
+    };
+    switch (field.code)
+    {
+    case 'b': return read(bool{});
+    case 'c': return read(char{});
+    case 'a': return read(static_cast<signed char>(0));
+    case 'h': return read(static_cast<unsigned char>(0));
+    case 's': return read(short{});
+    case 't': return read(static_cast<unsigned short>(0));
+    case 'i': return read(int{});
+    case 'j': return read(unsigned{});
+    case 'l': return read(long{});
+    case 'm': return read(static_cast<unsigned long>(0));
+    case 'x': return read(static_cast<long long>(0));
+    case 'y': return read(static_cast<unsigned long long>(0));
+    case 'f': return read(float{});
+    case 'd': return read(double{});
+    default: return 0;
+    }
+}
+
+void print_field_stats(const Dump& dump, const Field& field, size_t offset, std::string_view label)
+{
+    static constexpr size_t bins = 10;
+    static constexpr size_t distinct_limit = size_t{1} << 20;
+
+    const size_t record_size = dump.layout.record_size();
+    const size_t records = dump.rows.size() / record_size;
+    std::unordered_set<uint64_t> distinct;
+    for (size_t r = 0; r < records && distinct.size() < distinct_limit; r++)
+    {
+        distinct.insert(Caching::hash_bytes(std::span{dump.rows.data() + r * record_size + offset, field.size}));
+    }
+    std::printf("  %-10.*s %-9s distinct %s%zu\n", static_cast<int>(label.size()), label.data(), type_name(field).c_str(),
+                distinct.size() >= distinct_limit ? ">=" : "", distinct.size());
+    if (field.code == 0 || records == 0)
+    {
+        return;
+    }
+
+    std::vector<double> values(records);
+    for (size_t r = 0; r < records; r++)
+    {
+        values[r] = field_value(dump.rows.data() + r * record_size + offset, field);
+    }
+    const auto [min, max] = std::ranges::minmax(values);
+    const double mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(records);
+    std::printf("             min %g  max %g  mean %g\n", min, max, mean);
+
+    std::array<size_t, bins> counts{};
+    const double width = (max - min) / bins;
+    for (double value : values)
+    {
+        counts[width > 0 ? std::min(static_cast<size_t>((value - min) / width), bins - 1) : 0]++;
+    }
+    const size_t peak = *std::ranges::max_element(counts);
+    for (size_t b = 0; b < bins && width > 0; b++)
+    {
+        std::printf("             [%12g, %12g) %9zu %s\n", min + b * width, min + (b + 1) * width, counts[b],
+                    std::string(counts[b] * 40 / peak, '#').c_str());
+    }
+}
+
+/// @brief Reports bucket distribution of key hashes as std::unordered_map and a power of two table would see it
+void print_hash_quality(const Dump& dump)
+{
+    const size_t record_size = dump.layout.record_size();
+    const size_t key_size = dump.layout.key_size();
+    const size_t records = dump.rows.size() / record_size;
+    if (records == 0)
+    {
+        return;
+    }
+
+    std::vector<uint64_t> hashes(records);
+    for (size_t r = 0; r < records; r++)
+    {
+        hashes[r] = Caching::hash_bytes(std::span{dump.rows.data() + r * record_size, key_size});
+    }
+
+    std::unordered_set<std::string_view> keys;
+    for (size_t r = 0; r < records; r++)
+    {
+        keys.insert({reinterpret_cast<const char*>(dump.rows.data() + r * record_size), key_size});
+    }
+    std::ranges::sort(hashes);
+    const size_t unique_hashes = std::unique(hashes.begin(), hashes.end()) - hashes.begin();
+
+    std::printf("Hash quality (hash_bytes over key bytes, std::hash of Dependances)\n");
+    std::printf("  duplicate keys %zu, 64-bit hash collisions %zu\n", records - keys.size(), keys.size() - unique_hashes);
+
+    auto report = [&](std::string_view table, size_t bucket_count, auto bucket_of) {
+        std::vector<uint32_t> loads(bucket_count);
+        for (size_t i = 0; i < unique_hashes; i++)
+        {
+            loads[bucket_of(hashes[i])]++;
+        }
+        const double expected = static_cast<double>(unique_hashes) / bucket_count;
+        double chi2 = 0;
+        size_t empty = 0;
+        for (uint32_t load : loads)
+        {
+            chi2 += (load - expected) * (load - expected) / expected;
+            empty += load == 0;
+        }
+        std::printf("  %-22.*s buckets %9zu  longest chain %3u  empty %5.1f%% (uniform %5.1f%%)  chi2/df %.3f\n",
+                    static_cast<int>(table.size()), table.data(), bucket_count, *std::ranges::max_element(loads),
+                    100.0 * empty / bucket_count, 100.0 * std::exp(-expected), chi2 / std::max<size_t>(bucket_count - 1, 1));
+    };
+
+    const std::unordered_map<int, int> probe(unique_hashes);
+    const size_t prime_buckets = probe.bucket_count();
+    report("modulo prime (std)", prime_buckets, [&](uint64_t h) { return h % prime_buckets; });
+    const size_t pow2_buckets = std::bit_ceil(unique_hashes);
+    report("low bits (power of 2)", pow2_buckets, [&](uint64_t h) { return h & (pow2_buckets - 1); });
+}
+
+int info(const Dump& dump)
+{
+    const size_t records = dump.rows.size() / dump.layout.record_size();
+    std::printf("Format      %s\n", format_names[dump.format]);
+    std::printf("Layout      %s (key %zu bytes, value %zu bytes)\n", dump.layout.to_string().c_str(), dump.layout.key_size(),
+                dump.layout.value.size);
+    std::printf("Entries     %zu%s\n", records, dump.access_stats ? " with access counters" : "");
+    if (dump.format == Interned)
+    {
+        std::printf("Values      %zu distinct\n", dump.distinct_values);
+    }
+    std::printf("Fingerprint %016llx%s\n", static_cast<unsigned long long>(dump.fingerprint),
+                dump.fingerprint == dump.layout.fingerprint() || dump.format == Interned
+                    ? ""
+                    : " (includes schema versions or wrapped key types)");
+    std::printf("File size   %zu bytes (%.2f of row size)\n", dump.file_size,
+                dump.rows.empty() ? 0.0 : static_cast<double>(dump.file_size) / dump.rows.size());
+    if (!dump.problem.empty())
+    {
+        std::printf("Problem     %s\n", dump.problem.c_str());
+    }
+    std::printf("Fields\n");
+    size_t offset = 0;
+    for (size_t i = 0; i < dump.layout.key.size(); i++)
+    {
+        print_field_stats(dump, dump.layout.key[i], offset, "key[" + std::to_string(i) + "]");
+        offset += dump.layout.key[i].size;
+    }
+    print_field_stats(dump, dump.layout.value, offset, "value");
+    print_hash_quality(dump);
+    return 0;
+}
+
+/// @brief Describes first structural problem of a dump, empty if there is none
+std::string find_problem(const Dump& dump)
+{
+    if (!dump.problem.empty())
+    {
+        return dump.problem;
+    }
+    const size_t record_size = dump.layout.record_size();
+    const size_t key_size = dump.layout.key_size();
+    const size_t records = dump.rows.size() / record_size;
+    std::unordered_set<std::string_view> keys;
+    for (size_t r = 0; r < records; r++)
+    {
+        if (!keys.insert({reinterpret_cast<const char*>(dump.rows.data() + r * record_size), key_size}).second)
+        {
+            return "duplicate key in record " + std::to_string(r);
+        }
+    }
+    return {};
+}
+
+int validate(const Dump& dump)
+{
+    if (const std::string problem = find_problem(dump); !problem.empty())
+    {
+        std::printf("INVALID: %s\n", problem.c_str());
+        return 1;
+    }
+    const size_t records = dump.rows.size() / dump.layout.record_size();
+    std::printf("OK: %zu entries%s\n", records, dump.format != Raw ? ", checksum matches" : "");
+    return 0;
+}
+
+/// @brief Lists namespaces of a store with format, layout and entries of their dumps
+int store_info(const Store& store)
+{
+    std::printf("Format      store\n");
+    std::printf("Namespaces  %zu\n", store.namespaces.size());
+    std::printf("File size   %zu bytes\n", store.file_size);
+    if (!store.problem.empty())
+    {
+        std::printf("Problem     %s\n", store.problem.c_str());
+    }
+    for (const StoreNamespace& space : store.namespaces)
+    {
+        const Dump& dump = space.dump;
+        std::printf("  %s\n    fingerprint %016llx, %zu bytes", space.name.c_str(),
+                    static_cast<unsigned long long>(space.fingerprint), dump.file_size);
+        if (!dump.problem.empty())
+        {
+            std::printf(", %s\n", dump.problem.c_str());
+            continue;
+        }
+        std::printf(", %s, layout %s, %zu entries\n", format_names[dump.format], dump.layout.to_string().c_str(),
+                    dump.rows.size() / dump.layout.record_size());
+    }
+    return 0;
+}
+
+/// @brief Validates directory of a store and dumps of all its namespaces
+int store_validate(const Store& store)
+{
+    bool valid = store.problem.empty();
+    for (const StoreNamespace& space : store.namespaces)
+    {
+        std::printf("%s: ", space.name.c_str());
+        valid = validate(space.dump) == 0 && valid;
+    }
+    if (!store.problem.empty())
+    {
+        std::printf("INVALID: %s\n", store.problem.c_str());
+    }
+    return valid ? 0 : 1;
+}
+
+/// @brief Orders records by key fields compared by value, opaque fields bytewise
+void sort_rows(Bytes& rows, const Layout& layout)
+{
+    const size_t record_size = layout.record_size();
+    const size_t records = rows.size() / record_size;
+    std::vector<size_t> order(records);
+    std::iota(order.begin(), order.end(), 0);
+    auto less = [&](size_t lhs, size_t rhs) {
+        size_t offset = 0;
+        for (const Field& field : layout.key)
+        {
+            const std::byte* a = rows.data() + lhs * record_size + offset;
+            const std::byte* b = rows.data() + rhs * record_size + offset;
+            offset += field.size;
+            if (field.code == 0)
+            {
+                if (const int cmp = std::memcmp(a, b, field.size); cmp != 0)
+                {
+                    return cmp < 0;
+                }
+                continue;
+            }
+            const double va = field_value(a, field);
+            const double vb = field_value(b, field);
+            if (va != vb)
+            {
+                return va < vb;
+            }
+        }
+        return false;
+    };
+    std::ranges::stable_sort(order, less);
+
+    Bytes sorted(rows.size());
+    for (size_t r = 0; r < records; r++)
+    {
+        std::memcpy(sorted.data() + r * record_size, rows.data() + order[r] * record_size, record_size);
+    }
+    rows = std::move(sorted);
+}
+
+int convert(Dump dump, const std::string& out_path, std::string_view to)
+{
+    if (!dump.problem.empty())
+    {
+        std::fprintf(stderr, "refusing to convert invalid dump: %s\n", dump.problem.c_str());
+        return 1;
+    }
+    if (dump.format == Interned)
+    {
+        std::fprintf(stderr, "unsupported format: interned dumps are read by InternedCache only\n");
+        return 1;
+    }
+    const auto format = std::ranges::find(format_names, to) - std::begin(format_names);
+    switch (format)
+    {
+    case Sorted:
+        sort_rows(dump.rows, dump.layout);
+        [[fallthrough]];
+    case Row:
+    {
+        const std::string layout = dump.layout.to_string();
+        Caching::DumpHeader header;
+        header.fingerprint = dump.fingerprint;
+        header.count = dump.rows.size() / dump.layout.record_size();
+        header.payload_size = dump.rows.size();
+        Caching::DumpChecksum checksum;
+        checksum.update(dump.rows);
+        header.checksum = checksum.value();
+        header.key_size = static_cast<uint32_t>(dump.layout.key_size());
+        header.value_size = static_cast<uint32_t>(dump.layout.value.size);
+        header.layout_size = static_cast<uint32_t>(layout.size());
+
+        const auto header_bytes = Caching::encode_fields(header);
+        Bytes out(header_bytes.begin(), header_bytes.end());
+        out.insert(out.end(), reinterpret_cast<const std::byte*>(layout.data()),
+                   reinterpret_cast<const std::byte*>(layout.data() + layout.size()));
+        out.insert(out.end(), dump.rows.begin(), dump.rows.end());
+        write_file(out_path, out);
+        break;
+    }
+    case Raw:
+        write_file(out_path, dump.rows);
+        break;
+    case Columnar:
+    case Compressed:
+    {
+        const Bytes payload = format == Columnar ? columns_from_rows(dump.rows, dump.layout) : Caching::compress(dump.rows);
+        const std::string layout = dump.layout.to_string();
+        ContainerHeader header;
+        header.format = static_cast<uint32_t>(format);
+        header.records = dump.rows.size() / dump.layout.record_size();
+        header.payload_size = payload.size();
+        header.row_size = dump.rows.size();
+        header.checksum = Caching::hash_bytes(payload);
+        header.fingerprint = dump.fingerprint;
+        header.layout_size = static_cast<uint32_t>(layout.size());
+
+        const auto header_bytes = Caching::encode_fields(header);
+        Bytes out(header_bytes.begin(), header_bytes.end());
+        out.insert(out.end(), reinterpret_cast<const std::byte*>(layout.data()),
+                   reinterpret_cast<const std::byte*>(layout.data() + layout.size()));
+        out.insert(out.end(), payload.begin(), payload.end());
+        write_file(out_path, out);
+        break;
+    }
+    default:
+        std::fprintf(stderr, "unknown format %.*s\n", static_cast<int>(to.size()), to.data());
+        return 2;
+    }
+    std::printf("wrote %s (%s, %zu entries)\n", out_path.c_str(), format_names[format],
+                dump.rows.size() / dump.layout.record_size());
+    return 0;
+}
+
+/// @brief Writes header specializing Caching::embedded_dump<Tag> with records ordered by key hash
+int embed(const Dump& dump, const std::string& out_path, std::string_view tag, bool overlay)
+{
+    if (const std::string problem = find_problem(dump); !problem.empty())
+    {
+        std::fprintf(stderr, "refusing to embed invalid dump: %s\n", problem.c_str());
+        return 1;
+    }
+    if (dump.format == Interned)
+    {
+        std::fprintf(stderr, "unsupported format: interned dumps are read by InternedCache only\n");
+        return 1;
+    }
+    const size_t record_size = dump.layout.record_size();
+    const size_t key_size = dump.layout.key_size();
+    const size_t records = dump.rows.size() / record_size;
+
+    std::vector<std::pair<uint64_t, size_t>> order(records);
+    for (size_t r = 0; r < records; r++)
+    {
+        order[r] = {Caching::hash_bytes(std::span{dump.rows.data() + r * record_size, key_size}), r};
+    }
+    std::ranges::sort(order);
+
+    std::string ident = "table_";
+    for (char c : tag)
+    {
+        ident += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    }
+    std::string escaped_tag;
+    for (char c : tag)
+    {
+        escaped_tag += c == '"' || c == '\\' ? std::string{'\\', c} : std::string{c};
+    }
+
+    std::ofstream out{out_path};
+    out << "// Generated by cache-tool embed, do not edit\n"
+        << "// " << records << " entries, layout " << dump.layout.to_string() << "\n"
+        << "#pragma once\n\n#include \"embedded_dump.hpp\"\n\nnamespace Caching {\n\nnamespace embedded_data {\n\n";
+    // Arrays cannot be empty, a table without entries keeps one unused element
+    out << "alignas(64) inline constexpr uint64_t " << ident << "_hashes[] = {";
+    for (size_t r = 0; r < records; r++)
+    {
+        out << (r % 4 ? " " : "\n    ") << "0x" << std::hex << order[r].first << std::dec << "ull,";
+    }
+    out << (records == 0 ? "0" : "") << "\n};\n\n";
+    out << "alignas(64) inline constexpr unsigned char " << ident << "_records[] = {";
+    for (size_t r = 0; r < records; r++)
+    {
+        const std::byte* record = dump.rows.data() + order[r].second * record_size;
+        out << "\n   ";
+        for (size_t b = 0; b < record_size; b++)
+        {
+            out << " " << static_cast<unsigned>(record[b]) << ",";
+        }
+    }
+    out << (records == 0 ? "0" : "") << "\n};\n\n}  // namespace embedded_data\n\n";
+    out << "template <>\ninline constexpr EmbeddedDump embedded_dump<\"" << escaped_tag << "\"> = {\n"
+        << "    " << key_size << ", " << dump.layout.value.size << ", " << records << ", " << (overlay ? "true" : "false")
+        << ", embedded_data::" << ident << "_hashes, embedded_data::" << ident << "_records, 0x" << std::hex
+        << dump.fingerprint << std::dec << "ull};\n\n"
+        << "}  // namespace Caching\n";
+    if (!out)
+    {
+        std::fprintf(stderr, "cannot write %s\n", out_path.c_str());
+        return 2;
+    }
+    std::printf("wrote %s (%zu entries for Tag %.*s)\n", out_path.c_str(), records, static_cast<int>(tag.size()), tag.data());
+    return 0;
+}
+
+/// @brief Times reading the file and building a hash index of its keys as Cache does on startup
+int bench(const std::string& path, const std::optional<Layout>& layout_override, const std::optional<std::string_view>& space,
+          size_t reps, bool cold)
+{
+    using clock = std::chrono::steady_clock;
+    auto ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    struct KeyHash
+    {
+        size_t operator()(std::string_view key) const
+        {
+            return Caching::hash_bytes(std::as_bytes(std::span{key}));
+        }
+    };
+
+    std::vector<double> read_ms;
+    std::vector<double> decode_ms;
+    std::vector<double> index_ms;
+    size_t records = 0;
+    size_t file_size = 0;
+    for (size_t rep = 0; rep < reps; rep++)
+    {
+        if (cold)
+        {
+            // Drops clean cached pages of the file so the read hits storage
+            if (const int fd = ::open(path.c_str(), O_RDONLY); fd >= 0)
+            {
+                ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                ::close(fd);
+            }
+        }
+        const auto start = clock::now();
+        Bytes data = read_file(path);
+        const auto read = clock::now();
+        file_size = data.size();
+        const Dump dump = decode_dump(std::move(data), path, layout_override, space);
+        const auto decoded = clock::now();
+        if (!dump.problem.empty())
+        {
+            std::fprintf(stderr, "invalid dump: %s\n", dump.problem.c_str());
+            return 1;
+        }
+
+        const size_t record_size = dump.layout.record_size();
+        records = dump.rows.size() / record_size;
+        std::unordered_map<std::string_view, size_t, KeyHash> index;
+        index.reserve(records);
+        for (size_t r = 0; r < records; r++)
+        {
+            index.emplace(std::string_view{reinterpret_cast<const char*>(dump.rows.data() + r * record_size),
+                                           dump.layout.key_size()},
+                          r);
+        }
+        const auto indexed = clock::now();
+
+        read_ms.push_back(ms(read - start));
+        decode_ms.push_back(ms(decoded - read));
+        index_ms.push_back(ms(indexed - decoded));
+    }
+
+    auto median = [](std::vector<double> v) {
+        std::ranges::sort(v);
+        return v[v.size() / 2];
+    };
+    const double total = median(read_ms) + median(decode_ms) + median(index_ms);
+    std::printf("%zu entries, %zu bytes, %s page cache, median of %zu runs\n", records, file_size, cold ? "cold" : "warm",
+                reps);
+    std::printf("  read    %9.3f ms  %8.1f MB/s\n", median(read_ms), file_size / 1e3 / median(read_ms));
+    std::printf("  decode  %9.3f ms\n", median(decode_ms));
+    std::printf("  index   %9.3f ms  %8.1f ns/entry\n", median(index_ms), median(index_ms) * 1e6 / std::max<size_t>(records, 1));
+    std::printf("  total   %9.3f ms\n", total);
+    return 0;
+}
+
+int usage()
+{
+    std::fputs("usage: cache-tool info FILE [--layout KEY:VALUE]\n"
+               "       cache-tool validate FILE [--layout KEY:VALUE]\n"
+               "       cache-tool convert FILE OUT --to row|sorted|columnar|compressed|raw [--layout KEY:VALUE]\n"
+               "       cache-tool bench FILE [--reps N] [--cold] [--layout KEY:VALUE]\n"
+               "       cache-tool embed FILE OUT.hpp --tag TAG [--overlay] [--layout KEY:VALUE]\n"
+               "       FILE may be a DumpStore followed by --namespace NAME\n",
+               stderr);
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string_view> positional;
+    std::optional<Layout> layout;
+    std::string_view to;
+    std::optional<std::string_view> tag;
+    std::optional<std::string_view> space;
+    size_t reps = 5;
+    bool cold = false;
+    bool overlay = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--layout" && has_value)
+        {
+            layout = parse_layout(argv[++i]);
+            if (!layout)
+            {
+                std::fprintf(stderr, "invalid layout %s\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (arg == "--to" && has_value)
+        {
+            to = argv[++i];
+        }
+        else if (arg == "--reps" && has_value)
+        {
+            reps = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (arg == "--tag" && has_value)
+        {
+            tag = argv[++i];
+        }
+        else if (arg == "--namespace" && has_value)
+        {
+            space = argv[++i];
+        }
+        else if (arg == "--cold")
+        {
+            cold = true;
+        }
+        else if (arg == "--overlay")
+        {
+            overlay = true;
+        }
+        else if (arg.starts_with("--"))
+        {
+            return usage();
+        }
+        else
+        {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() < 2)
+    {
+        return usage();
+    }
+
+    const std::string_view command = positional[0];
+    const std::string path{positional[1]};
+    if ((command == "info" || command == "validate") && positional.size() == 2)
+    {
+        Bytes data = read_file(path);
+        if (!space && is_store(data))
+        {
+            return command == "info" ? store_info(decode_store(data)) : store_validate(decode_store(data));
+        }
+        const Dump dump = decode_dump(std::move(data), path, layout, space);
+        return command == "info" ? info(dump) : validate(dump);
+    }
+    if (command == "convert" && positional.size() == 3 && !to.empty())
+    {
+        return convert(load_dump(path, layout, space), std::string{positional[2]}, to);
+    }
+    if (command == "bench" && positional.size() == 2)
+    {
+        return bench(path, layout, space, reps, cold);
+    }
+    if (command == "embed" && positional.size() == 3 && tag)
+    {
+        return embed(load_dump(path, layout, space), std::string{positional[2]}, *tag, overlay);
+    }
+    return usage();
+}